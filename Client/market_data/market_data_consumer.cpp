@@ -4,20 +4,23 @@
 namespace Trading {
     MarketDataConsumer::MarketDataConsumer(Common::ClientId clientId, Exchange::MEMarketUpdateLFQueue *marketUpdates, const std::string &iface,
             const std::string &snapshopIp, int snapshotPort,
-            const std::string &incrementalIp, int incrementalPort) : _incomingMDUpdates(marketUpdates), _logger("trading_market_data_consumer" + std::to_string(clientId) + ".log"),
-            _run(false), _incrementalMcastSocket(_logger), _snapshotMcastSocket(_logger), _iface(iface), _snapshotIp(snapshopIp), _snapshotPort(snapshotPort) 
+            const std::string &incrementalIp, int incrementalPort, Common::McastBackend backend,
+            const std::string &incrementalIpB, int incrementalPortB) : _incomingMDUpdates(marketUpdates), _logger("trading_market_data_consumer" + std::to_string(clientId) + ".log"),
+            _run(false), _incrementalMcastSocket(_logger), _incrementalMcastSocketB(_logger), _snapshotMcastSocket(_logger), _iface(iface), _snapshotIp(snapshopIp), _snapshotPort(snapshotPort) 
     {
-        auto recv_callback = [this](auto socket) {
-            recvCallback(socket);
-        };
-
-        _incrementalMcastSocket.recv_callback = recv_callback;
-
+        _incrementalMcastSocket.backend = backend;
+        _incrementalMcastSocketB.backend = backend;
+        _snapshotMcastSocket.backend = backend;
         // create socket to receive incremental updates and join multicast stream
         ASSERT(_incrementalMcastSocket.init(incrementalIp, iface, incrementalPort, true) >= 0, "Unable to create incremental mcast socket. error:" + std::string(std::strerror(errno)));
         ASSERT(_incrementalMcastSocket.join(incrementalIp), "Join failed on:" + std::to_string(_incrementalMcastSocket.socketFd) + " error:" + std::string(std::strerror(errno)));
-    
-        _snapshotMcastSocket.recv_callback = recv_callback;
+
+        // the B line carries the same packets, whichever line delivers an update first is used
+        if (!incrementalIpB.empty()) {
+            ASSERT(_incrementalMcastSocketB.init(incrementalIpB, iface, incrementalPortB, true) >= 0, "Unable to create incremental B mcast socket. error:" + std::string(std::strerror(errno)));
+            ASSERT(_incrementalMcastSocketB.join(incrementalIpB), "Join failed on:" + std::to_string(_incrementalMcastSocketB.socketFd) + " error:" + std::string(std::strerror(errno)));
+            _numLines = 2;
+        }
     }
     
     MarketDataConsumer::~MarketDataConsumer() {
@@ -38,56 +41,108 @@ namespace Trading {
 
     auto MarketDataConsumer::run() noexcept -> void {
         _logger.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr));
+        // called straight from the read, not through the sockets' recv_callback, so the parsing gets inlined
+        auto onRecv = [this](McastSocket* socket, Nanos rxTime) {
+            recvCallback(socket, rxTime);
+        };
+
         while(_run) {
-            _incrementalMcastSocket.sendAndRecv();
-            _snapshotMcastSocket.sendAndRecv();
+            _incrementalMcastSocket.sendAndRecv(onRecv);
+            if (_numLines > 1)
+                _incrementalMcastSocketB.sendAndRecv(onRecv);
+            _snapshotMcastSocket.sendAndRecv(onRecv);
         }
     }
 
-    auto MarketDataConsumer::recvCallback(McastSocket *socket) noexcept -> void {
-        const auto isSnapshot = (socket->socketFd == _snapshotMcastSocket.socketFd);
+    auto MarketDataConsumer::recvCallback(McastSocket *socket, Nanos rxTime) noexcept -> void {
+        const auto isSnapshot = (socket == &_snapshotMcastSocket);
+        const size_t line = (socket == &_incrementalMcastSocketB);
+        // time between the kernel receiving the datagram and us getting to it
+        _logger.log("%:% %() % Received % socket:% len:% wire-to-app:%ns\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), (isSnapshot ? "snapshot" : (line ? "incremental B" : "incremental")), socket->socketFd, socket->next_recv_valid_index, (rxTime ? Common::getCurrentNanos() - rxTime : 0));
         
         if (UNLIKELY(isSnapshot && !_inRecovery)) {
-            socket->next_recv_valid_index = 0;
             _logger.log("%:% %() % WARN Not expecting snapshot messages.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr));
             return;
         }
 
-        // iterate through MDPMarketUpdates
-        if (socket->next_recv_valid_index >= sizeof(Exchange::MDPMarketUpdate)) {
-            size_t i = 0;
-            for (; i + sizeof(Exchange::MDPMarketUpdate) <= socket->next_recv_valid_index; i += sizeof(Exchange::MDPMarketUpdate)) {
-                auto request = reinterpret_cast<const Exchange::MDPMarketUpdate*>(socket->recv_buffer.data() + i);
-                _logger.log("%:% %() % Received % socket len:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), (isSnapshot ? "snapshot" : "incremental"), sizeof(Exchange::MDPMarketUpdate), request->toString());
-            
-                // check if need to go into recovery mode
-                const bool alreadyInRecovery = _inRecovery;
-                _inRecovery = (alreadyInRecovery || request->seqNumber != _nextExpIncSeqNum);
-            
-                // if packet was dropped start recovery process if no already started
-                if(UNLIKELY(_inRecovery)) {
-                    if (UNLIKELY(!alreadyInRecovery))  {
-                        _logger.log("%:% %() % Packet drops on % socket. SeqNum expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), (isSnapshot ? "snapshot" : "incremental"), _nextExpIncSeqNum, request->seqNumber);
-                        startSnapshotSync();
-                    }
-
-                    queueMessage(isSnapshot, request); // queue messages while on recovery
-                } else if (!isSnapshot) { // received regular market update (not on recovery)
-                    _logger.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), request->toString());
-                    ++_nextExpIncSeqNum;
-
-                    auto nextWrite = _incomingMDUpdates->getNextWriteTo();
-                    *nextWrite = std::move(request->meMarketUpdate);
-                    _incomingMDUpdates->updateWriteIndex();
-                }
-            }
+        const auto len = socket->next_recv_valid_index;
+        const auto data = socket->recvData();
+        const auto headerLength = Common::wireMessageLength(data, len);
+        Exchange::MDPPacketHeader header;
+        if (UNLIKELY(!headerLength || !Exchange::MDPPacketHeaderCodec::decode(data, header) || len < headerLength + header.numUpdates * header.updateLength)) {
+            _logger.log("%:% %() % WARN Malformed % packet len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), (isSnapshot ? "snapshot" : "incremental"), len);
+            return;
+        }
+
+        _logger.log("%:% %() % Received % send-to-app:%ns\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), header.toString(), Common::getCurrentNanos() - header.sendTime);
+        // the header tells whether a packet went missing before looking at its updates, with two lines the
+        // other one may still deliver it
+        if (!isSnapshot && !_inRecovery && header.firstSeqNumber > _nextExpIncSeqNum)
+            _logger.log("%:% %() % Packet gap on incremental line:%. SeqNum expected:% packet starts at:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), line, _nextExpIncSeqNum, header.firstSeqNumber);
+
+        // decode the MDPMarketUpdates of the packet, updates never span packets and are numbered from firstSeqNumber
+        const auto updates = data + headerLength;
+        for (size_t i = 0; i < header.numUpdates; i++) {
+            Exchange::MDPMarketUpdate update;
+            update.seqNumber = header.firstSeqNumber + i;
+            Exchange::MDPMarketUpdateCodec::decodeBlock(updates + i * header.updateLength, header.updateLength, update);
+            const auto request = &update;
+            _logger.log("%:% %() % Received % socket len:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), (isSnapshot ? "snapshot" : "incremental"), header.updateLength, request->toString());
 
-            // shift data in buffer and adjust its size
-            memcpy(socket->recv_buffer.data(), socket->recv_buffer.data() + i, socket->next_recv_valid_index - i);
-            socket->next_recv_valid_index -= i;
+            if (!isSnapshot)
+                _lineNextSeqNum[line] = std::max(_lineNextSeqNum[line], request->seqNumber + 1);
+
+            if (UNLIKELY(_inRecovery))
+                queueMessage(isSnapshot, request); // queue messages while on recovery
+            else
+                arbitrate(line, request);
         }
     }
 
+    auto MarketDataConsumer::arbitrate(size_t line, const Exchange::MDPMarketUpdate *request) noexcept -> void {
+        // already taken from the other line
+        if (request->seqNumber < _nextExpIncSeqNum)
+            return;
+
+        if (UNLIKELY(request->seqNumber > _nextExpIncSeqNum)) {
+            _arbitrationQueuedMsgs[request->seqNumber] = request->meMarketUpdate;
+
+            bool allLinesMissed = true;
+            for (size_t i = 0; i < _numLines; i++)
+                allLinesMissed &= (_lineNextSeqNum[i] > _nextExpIncSeqNum + 1);
+            if (!allLinesMissed && _arbitrationQueuedMsgs.size() < MD_ARBITRATION_MAX_QUEUED)
+                return;
+
+            // if packet was dropped on every line start recovery process, the updates held back are part of it
+            _logger.log("%:% %() % Packet drops on % line(s). SeqNum expected:% received:% line A wins:% line B wins:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr),
+                        _numLines, _nextExpIncSeqNum, request->seqNumber, _lineWins[0], _lineWins[1]);
+            _inRecovery = true;
+            startSnapshotSync();
+            _incrementalQueuedMsgs.swap(_arbitrationQueuedMsgs);
+            return;
+        }
+
+        // received regular market update (not on recovery)
+        _logger.log("%:% %() % line:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), line, request->toString());
+        _lineWins[line]++;
+        publish(request->meMarketUpdate);
+
+        // the gap is filled, whatever the other line delivered past it follows
+        while (!_arbitrationQueuedMsgs.empty() && _arbitrationQueuedMsgs.begin()->first <= _nextExpIncSeqNum) {
+            if (_arbitrationQueuedMsgs.begin()->first == _nextExpIncSeqNum)
+                publish(_arbitrationQueuedMsgs.begin()->second);
+            _arbitrationQueuedMsgs.erase(_arbitrationQueuedMsgs.begin());
+        }
+    }
+
+    auto MarketDataConsumer::publish(const Exchange::MEMarketUpdate &update) noexcept -> void {
+        ++_nextExpIncSeqNum;
+
+        auto nextWrite = _incomingMDUpdates->getNextWriteTo();
+        *nextWrite = update;
+        _incomingMDUpdates->updateWriteIndex();
+    }
+
     auto MarketDataConsumer::startSnapshotSync() noexcept -> void {
         _snapshotQueuedMsgs.clear();
         _incrementalQueuedMsgs.clear();
@@ -105,6 +160,8 @@ namespace Trading {
             }
 
             _snapshotQueuedMsgs[request->seqNumber] = request->meMarketUpdate;
+            if (request->meMarketUpdate.type == Exchange::MarketUpdateType::SNAPSHOT_END)
+                _snapshotIncSeqNum = request->incSeqNumber;
         } else {
             _incrementalQueuedMsgs[request->seqNumber] = request->meMarketUpdate;
         }
@@ -160,7 +217,7 @@ namespace Trading {
         // inspect incremental messages to make sure no gaps are detected
         auto haveCompleteIncremental= true;
         size_t numIncrementals = 0;
-        _nextExpIncSeqNum = lastSnapshotMsg.orderId + 1;
+        _nextExpIncSeqNum = _snapshotIncSeqNum + 1;
 
         for (auto incItr = _incrementalQueuedMsgs.begin(); incItr != _incrementalQueuedMsgs.end(); ++incItr) {
             _logger.log("%:% %() % Checking next_exp:% vs. seq:% %.\n", __FILE__, __LINE__, __FUNCTION__,Common::getCurrentTimeStr(&_timeStr), _nextExpIncSeqNum, incItr->first, incItr->second.toString());
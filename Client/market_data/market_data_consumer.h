@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <functional>
 #include <map>
 #include "thread_utils.h"
@@ -10,11 +11,16 @@
 
 
 namespace Trading {
+    // most updates held back waiting for the other line to fill a gap, a line that stopped sending would hold
+    // recovery back forever otherwise
+    constexpr size_t MD_ARBITRATION_MAX_QUEUED = 4 * 1024;
+
     class MarketDataConsumer {
     public:
         MarketDataConsumer(Common::ClientId clientId, Exchange::MEMarketUpdateLFQueue *marketUpdates, const std::string &iface,
             const std::string &snapshopIp, int snapshotPort,
-            const std::string &incrementalIp, int incrementalPort);
+            const std::string &incrementalIp, int incrementalPort, Common::McastBackend backend = Common::McastBackend::SOCKET,
+            const std::string &incrementalIpB = "", int incrementalPortB = 0);
         ~MarketDataConsumer();
 
         MarketDataConsumer() = delete;
@@ -29,12 +35,17 @@ namespace Trading {
         typedef std::map<size_t, Exchange::MEMarketUpdate> QueuedMarketUpdates;
     private:
         // method for processing incoming requests
-        auto recvCallback(McastSocket *socket) noexcept -> void;    
+        auto recvCallback(McastSocket *socket, Nanos rxTime) noexcept -> void;    
 
         auto run() noexcept -> void;
         auto stop() noexcept -> void;
         // method that starts synchronization process when packet drops is detected
         auto startSnapshotSync() noexcept -> void;
+        // method for taking an incremental update from line A or B, first arrival wins and duplicates are dropped
+        // a gap only starts synchronization once every line went past the missing sequence number
+        auto arbitrate(size_t line, const Exchange::MDPMarketUpdate *request) noexcept -> void;
+        // method for handing an in sequence update to the trading engine
+        auto publish(const Exchange::MEMarketUpdate &update) noexcept -> void;
         // method for handling messages while on synchronization process
         auto queueMessage(bool isSnapshot, const Exchange::MDPMarketUpdate *request) -> void;
         // method for checking if recovery is possible from queued up messages
@@ -49,15 +60,26 @@ namespace Trading {
         Logger _logger;
         // socket for receiving incremental updates from exchange
         Common::McastSocket _incrementalMcastSocket;
+        // socket for receiving the B copy of the incremental updates, only joined when a B line is given
+        Common::McastSocket _incrementalMcastSocketB;
+        size_t _numLines = 1;
+        // one past the highest sequence number seen on each line
+        std::array<size_t, 2> _lineNextSeqNum = {};
+        // updates each line delivered first
+        std::array<size_t, 2> _lineWins = {};
+        // updates ahead of a gap, held while the other line may still fill it
+        QueuedMarketUpdates _arbitrationQueuedMsgs;
         // socket for receiving ordebook snapshots
         Common::McastSocket _snapshotMcastSocket;
         // indicates wether or not a packet has dropped
-        bool _inRecovery;
+        bool _inRecovery = false;
         const std::string _iface; 
         // for connecting to snapshot stream
         const std::string _snapshotIp;
         const int _snapshotPort;
         // queue for holding snapshot messages & incremental market updates 
         QueuedMarketUpdates _snapshotQueuedMsgs, _incrementalQueuedMsgs;
+        // incSeqNumber of the SNAPSHOT_END queued, the last incremental update the snapshot includes
+        Common::SeqNum _snapshotIncSeqNum = 0;
     };
 }
\ No newline at end of file
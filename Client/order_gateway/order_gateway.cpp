@@ -1,18 +1,23 @@
 #include "order_gateway.h"
 
 namespace Trading {
-    OrderGateway::OrderGateway(ClientId clientId, Exchange::ClientRequestLFQueue* clientRequests, Exchange::ClientResponseLFQueue* clientResponses, std::string ip, const std::string iface, int port) 
+    OrderGateway::OrderGateway(ClientId clientId, Exchange::ClientRequestLFQueue* clientRequests, Exchange::ClientResponseLFQueue* clientResponses, std::string ip, const std::string iface, int port, Common::TCPBackend backend) 
     : _clientId(clientId), _ip(ip), _iface(iface), _port(port), _outgoingRequests(clientRequests),
       _incomingResponses(clientResponses),  _logger("trading_order_gateway" + std::to_string(clientId) + ".log"),
       _tcpSocket(_logger)
     {
-        _tcpSocket.recv_callback = [this](auto socket, auto rx_time) {recvCallback(socket, rx_time);};    
+        if (backend != Common::TCPBackend::EPOLL)
+            _tcpRing = new Common::TCPRing(_logger, backend == Common::TCPBackend::IO_URING_SQPOLL);
     }
 
     auto OrderGateway::start() noexcept -> void {
         _run = true;
         
         ASSERT(_tcpSocket.connect(_ip, _iface, _port, false) >= 0, "Unable to connect to ip: " + _ip + " port: " + std::to_string(_port) + " on iface: " + _iface + " error: " + std::string(std::strerror(errno)));
+        if (_tcpRing) {
+            _tcpRing->addSocket(&_tcpSocket);
+            _tcpSocket.send_ring = _tcpRing;
+        }
         ASSERT(Common::createAndStartThread(-1, "Trading/OrderGateway", [this](){run();}) != nullptr, "Failed to start OrderGateway thread.");
     }
 
@@ -20,6 +25,8 @@ namespace Trading {
         stop();
         using namespace std::literals::chrono_literals;
         std::this_thread::sleep_for(5s);
+        delete _tcpRing;
+        _tcpRing = nullptr;
     }
 
     auto OrderGateway::stop() noexcept -> void {
@@ -28,27 +35,86 @@ namespace Trading {
 
     auto OrderGateway::run() noexcept -> void {
         _logger.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr));
+        // called straight from the read, not through the socket's recv_callback, so the parsing gets inlined
+        auto onRecv = [this](TCPSocket* socket, Nanos rx_time) {
+            recvCallback(socket, rx_time);
+        };
+
         while(_run) {
-            _tcpSocket.sendAndRecv();
+            if (_tcpRing) {
+                // the requests queued last loop and the read are handled by a single io_uring_enter()
+                _tcpSocket.flush();
+                _tcpRing->poll(onRecv);
+            } else {
+                _tcpSocket.sendAndRecv(onRecv);
+            }
 
             // loop throught requests and dispatch them
             for (auto clientRequest = _outgoingRequests->getNextRead(); clientRequest; clientRequest = _outgoingRequests->getNextRead()) {
+                if (clientRequest->type == Exchange::ClientRequestType::QUOTE) {
+                    addQuote(*clientRequest);
+                    _outgoingRequests->updateReadIndex();
+                    continue;
+                }
+
+                // quotes read before this request go out first
+                sendMassQuote();
                 _logger.log("%:% %() % Sending cid:% seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), _clientId, _nextOutgoingSeqNum, clientRequest->toString());
                 
-                _tcpSocket.send(&_nextOutgoingSeqNum, sizeof(_nextOutgoingSeqNum));
-                _tcpSocket.send(clientRequest, sizeof(Exchange::MEClientRequest));
+                char encoded[Exchange::OMClientRequestCodec::MessageLength];
+                _tcpSocket.send(encoded, Exchange::OMClientRequestCodec::encode({_nextOutgoingSeqNum, *clientRequest}, encoded));
                 _outgoingRequests->updateReadIndex();
                 _nextOutgoingSeqNum++;
             }
+            sendMassQuote();
+        }
+    }
+
+    auto OrderGateway::addQuote(const Exchange::MEClientRequest& quote) noexcept -> void {
+        auto& entries = _massQuote.entries;
+        const bool sameTicker = (_massQuote.numEntries && entries[_massQuote.numEntries - 1].tickerId == quote.tickerId);
+        if (!sameTicker && _massQuote.numEntries == entries.size())
+            sendMassQuote();
+
+        // the id of its first quote identifies the mass quote, fills & the ack report it
+        if (!_massQuote.numEntries)
+            _massQuote.quoteId = quote.orderId;
+        auto& entry = (sameTicker ? entries[_massQuote.numEntries - 1] : (entries[_massQuote.numEntries++] = {quote.tickerId}));
+        if (quote.side == Side::Buy) {
+            entry.bidPrice = quote.price;
+            entry.bidQty = quote.qty;
+        } else {
+            entry.askPrice = quote.price;
+            entry.askQty = quote.qty;
         }
     }
 
+    auto OrderGateway::sendMassQuote() noexcept -> void {
+        if (!_massQuote.numEntries)
+            return;
+
+        _massQuote.seqNum = _nextOutgoingSeqNum++;
+        _massQuote.clientId = _clientId;
+        _logger.log("%:% %() % Sending %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), _massQuote.toString());
+
+        char encoded[Exchange::OMMassQuoteCodec::MaxMessageLength];
+        _tcpSocket.send(encoded, Exchange::OMMassQuoteCodec::encode(_massQuote, encoded));
+        _massQuote.numEntries = 0;
+    }
+
     auto OrderGateway::recvCallback(TCPSocket* socket, Nanos rx_time) noexcept -> void {
-        _logger.log("%:% %() % Received socket:% len:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), socket->fd,socket->next_recv_valid_index, rx_time);
-        if (socket->next_recv_valid_index >= sizeof(Exchange::OMClientResponse)) {
+        _logger.log("%:% %() % Received socket:% len:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), socket->fd, socket->recvSize(), rx_time);
+        if (socket->recvSize() >= Common::WIRE_HEADER_SIZE) {
+            const auto data = socket->recvData();
+            const auto size = socket->recvSize();
             size_t i = 0;
-            for (; i + sizeof(Exchange::OMClientResponse) <= socket->next_recv_valid_index; i += sizeof(Exchange::OMClientResponse)) {
-                auto response = reinterpret_cast<Exchange::OMClientResponse*>(socket->recv_buffer.data() + i);
+            for (size_t length; (length = Common::wireMessageLength(data + i, size - i)); i += length) {
+                Exchange::OMClientResponse decoded;
+                if (UNLIKELY(!Exchange::OMClientResponseCodec::decode(data + i, decoded))) {
+                    _logger.log("%:% %() % Skipping unknown message template:% len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), Common::decodeWireHeader(data + i).templateId, length);
+                    continue;
+                }
+                const auto response = &decoded;
                 _logger.log("%:% %() % Received %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), response->toString());
             
                 if (response->meClientResponse.clientId != _clientId) {
@@ -65,13 +131,12 @@ namespace Trading {
 
                 // forwad response to trading engine
                 auto nextWrite = _incomingResponses->getNextWriteTo();
-                *nextWrite = std::move(response->meClientResponse);
+                *nextWrite = response->meClientResponse;
                 _incomingResponses->updateWriteIndex();
-                
-                // remove response from recv buffer
-                memcpy(socket->recv_buffer.data(), socket->recv_buffer.data() + i, socket->next_recv_valid_index - i);
-                socket->next_recv_valid_index -= i;
             }
+
+            // remove processed responses from recv buffer
+            socket->commitRecv(i);
         }
     }
 }
\ No newline at end of file
@@ -10,7 +10,7 @@
 namespace Trading {
     class OrderGateway {
     public:
-        OrderGateway(ClientId clientId, Exchange::ClientRequestLFQueue* clientRequests, Exchange::ClientResponseLFQueue* clientResponses, std::string ip, const std::string iface, int port);
+        OrderGateway(ClientId clientId, Exchange::ClientRequestLFQueue* clientRequests, Exchange::ClientResponseLFQueue* clientResponses, std::string ip, const std::string iface, int port, Common::TCPBackend backend = Common::TCPBackend::EPOLL);
         ~OrderGateway();
 
         OrderGateway() = delete;
@@ -25,6 +25,10 @@ namespace Trading {
     private:
         auto run() noexcept -> void;
         auto recvCallback(TCPSocket* socket, Nanos rx_time) noexcept -> void;
+        // method for adding a QUOTE to the mass quote being built, bid & ask of a ticker sent back to back share an entry
+        auto addQuote(const Exchange::MEClientRequest& quote) noexcept -> void;
+        // method for sending the mass quote being built, if it has any entries
+        auto sendMassQuote() noexcept -> void;
 
         const ClientId _clientId;
         std::string _ip;
@@ -39,7 +43,11 @@ namespace Trading {
         Logger _logger;
         size_t _nextOutgoingSeqNum = 1;
         size_t _nextExpSeqNum = 1;
+        // the QUOTEs read from the trading engine go out as a single mass quote
+        Exchange::OMMassQuote _massQuote;
         // socket to connect to exchange and send and receive messages
         Common::TCPSocket _tcpSocket;
+        // reads and sends of _tcpSocket go through this ring when an io_uring backend is selected
+        Common::TCPRing* _tcpRing = nullptr;
     };
 }
\ No newline at end of file
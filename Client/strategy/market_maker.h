@@ -46,7 +46,7 @@ namespace Trading {
                 const auto bidPrice = bbo->bidPrice - (fairPrice - bbo->bidPrice >= threshold? 0 : 1);
                 const auto askPrice = bbo->askPrice - (fairPrice - bbo->askPrice >= threshold? 0 : 1);
                 
-                _orderManager->moveOrders(tickerId, bidPrice, askPrice, clip);
+                _orderManager->quoteOrders(tickerId, bidPrice, askPrice, clip);
             }
         }
 
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <array>
+#include <vector>
 #include <sstream>
 #include "types.h"
+#include "order_id_index.h"
 
 using namespace Common;
 
@@ -36,8 +38,8 @@ namespace Trading {
         };
     };
 
-    // map that maps ids to MarketOrders
-    typedef std::array<MarketOrder *, ME_MAX_ORDER_IDS> OrderHashMap;
+    // map that maps market order ids to the live MarketOrders, sized to the orders of the instrument
+    typedef OrderIdIndex<MarketOrder> OrderHashMap;
 
     // struct that represents grouping of orders of same price level
     struct MarketOrderAtPrice {
@@ -64,8 +66,8 @@ namespace Trading {
         }
     };
 
-    // map that maps price levels to MarketOrderAtPrice
-    typedef std::array<MarketOrderAtPrice*, ME_MAX_PRICE_LEVELS> OrdersAtPriceHashMap;
+    // map that maps price levels to MarketOrderAtPrice, sized to the price levels of the instrument
+    typedef std::vector<MarketOrderAtPrice*> OrdersAtPriceHashMap;
  
     // struct representing a BBO (Best Bid & offer)
     struct BBO {
@@ -2,14 +2,15 @@
 #include "trading_engine.h"
 
 namespace Trading {
-    MarketOrderBook::MarketOrderBook(TickerId tickerId, Logger* logger) : _tickerId(tickerId), _logger(logger), _ordersAtPricePool(ME_MAX_PRICE_LEVELS), _orderPool(ME_MAX_ORDER_IDS) 
+    MarketOrderBook::MarketOrderBook(const InstrumentCfg& instrument, Logger* logger) : _tickerId(instrument.tickerId), _instrument(instrument), _logger(logger),
+        _oidToOrder(instrument.maxOrders), _ordersAtPricePool(instrument.maxPriceLevels), _orderPool(instrument.maxOrders), _priceOrdersAtPrice(instrument.maxPriceLevels, nullptr) 
     {}
 
     MarketOrderBook::~MarketOrderBook() {
         _logger->log("%:% %() % OrderBook\n%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), toString(false, true));
         _tradingEngine = nullptr;
         _bidsByPrice = _asksByPrice = nullptr;
-        _oidToOrder.fill(nullptr);
+        _oidToOrder.clear();
     }
 
     auto MarketOrderBook::setTradingEngine(TradingEngine* tradingEngine) noexcept -> void {
@@ -22,8 +23,8 @@ namespace Trading {
 
     auto MarketOrderBook::onMarketUpdate(const Exchange::MEMarketUpdate* marketUpdate) noexcept -> void {
         // see wether or not we need to update BBO
-        const auto bidsUpdated = (_bidsByPrice && marketUpdate->side == Side::Buy && marketUpdate->price >= _bidsByPrice->price);
-        const auto askUpdated = (_asksByPrice && marketUpdate->side == Side::Sell && marketUpdate->price >= _asksByPrice->price);
+        auto bidsUpdated = (_bidsByPrice && marketUpdate->side == Side::Buy && marketUpdate->price >= _bidsByPrice->price);
+        auto askUpdated = (_asksByPrice && marketUpdate->side == Side::Sell && marketUpdate->price >= _asksByPrice->price);
 
         switch (marketUpdate->type) {
             case Exchange::MarketUpdateType::ADD: {
@@ -32,15 +33,30 @@ namespace Trading {
             }
                 break;
             case Exchange::MarketUpdateType::MODIFY: {
-                auto order = _oidToOrder.at(marketUpdate->orderId);
-                order->qty = marketUpdate->qty;
+                auto order = _oidToOrder.find(marketUpdate->orderId);
+                if (order->price == marketUpdate->price && order->priority == marketUpdate->priority) {
+                    order->qty = marketUpdate->qty;
+                } else {
+                    // an amended order that lost its priority goes to the back of its new price level, it may have left the best one
+                    bidsUpdated |= (order->side == Side::Buy);
+                    askUpdated |= (order->side == Side::Sell);
+                    removeOrder(order);
+                    order = _orderPool.allocate(marketUpdate->orderId, marketUpdate->side, marketUpdate->price, marketUpdate->qty, marketUpdate->priority, nullptr, nullptr);
+                    addOrder(order);
+                }
             }
                 break;
             case Exchange::MarketUpdateType::CANCEL: {
-                auto order = _oidToOrder.at(marketUpdate->orderId);
+                auto order = _oidToOrder.find(marketUpdate->orderId);
                 removeOrder(order);
             }
                 break;
+            case Exchange::MarketUpdateType::LEVEL_CLEAR: {
+                // a sweep took every order at the price, the level goes with the last one
+                for (auto ordersAtPrice = getOrdersAtPrice(marketUpdate->price); ordersAtPrice && ordersAtPrice->side == marketUpdate->side; ordersAtPrice = getOrdersAtPrice(marketUpdate->price))
+                    removeOrder(ordersAtPrice->firstMarketOrder);
+            }
+                break;
             case Exchange::MarketUpdateType::TRADE: {
                 _tradingEngine->onTradeUpdate(marketUpdate, this);
                 return;
@@ -48,13 +64,10 @@ namespace Trading {
                 break;
             case Exchange::MarketUpdateType::CLEAR: {
                 // clear orderBook for sync up to happen
-                for (auto &order : _oidToOrder) {
-                    if (order) {
-                        _orderPool.deallocate(order);
-                    }
-                }
-
-                _oidToOrder.fill(nullptr);
+                _oidToOrder.forEach([this](MarketOrder* order) {
+                    _orderPool.deallocate(order);
+                });
+                _oidToOrder.clear();
 
                 if (_bidsByPrice) {
                     for (auto bid = _bidsByPrice->nextEntry; bid != _bidsByPrice; bid = bid->nextEntry)
@@ -112,12 +125,12 @@ namespace Trading {
         }
     }
     
-    auto MarketOrderBook::getOrdersAtPrice(Price price) const noexcept {
+    auto MarketOrderBook::getOrdersAtPrice(Price price) const noexcept -> MarketOrderAtPrice* {
         return _priceOrdersAtPrice.at(priceToIndex(price));
     }
 
     auto MarketOrderBook::priceToIndex(Price price) const noexcept -> void {
-        return (price % ME_MAX_PRICE_LEVELS);
+        return _instrument.priceToIndex(price);
     }
 
     auto MarketOrderBook::removeOrder(MarketOrder* order) noexcept -> void {
@@ -136,7 +149,7 @@ namespace Trading {
             order->prevOrder = order->nextOrder = order;
         }
 
-        _cidOidToOrder.at(order->clientId).at(order->clientOrderId) = nullptr;
+        _oidToOrder.erase(order->orderId);
         _orderPool.deallocate(order);
     }
 
@@ -174,8 +187,8 @@ namespace Trading {
             order->prevOrder = firstOrder->prevOrder;
             order->nextOrder = nullptr;
             firstOrder->prevOrder = order;
-            _cidOidToOrder.at(order->clientId).at(order->clientOrderId) = order;
         }
+        _oidToOrder.insert(order->orderId, order);
     }
 
     auto MarketOrderBook::addOrdersAtPrice(MarketOrderAtPrice* newOrdersAtPrice) noexcept -> void {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "types.h"
+#include "instrument_registry.h"
 #include "mem_pool.h"
 #include "logging.h"
 #include "market_order.h"
@@ -11,7 +12,7 @@ namespace Trading {
     
     class MarketOrderBook {
     public:
-        MarketOrderBook(TickerId tickerId, Logger* logger);
+        MarketOrderBook(const InstrumentCfg& instrument, Logger* logger);
         ~MarketOrderBook();
 
         MarketOrderBook() = delete;
@@ -31,25 +32,26 @@ namespace Trading {
         // method for updating BBO structure
         auto updateBBO(bool updateBid, bool updateAsks) noexcept;
         auto priceToIndex(Price price) const noexcept -> void;
-        auto getOrdersAtPrice(Price price) const noexcept;
+        auto getOrdersAtPrice(Price price) const noexcept -> MarketOrderAtPrice*;
         auto addOrder(MarketOrder* order) noexcept -> void;
         auto addOrdersAtPrice(MarketOrderAtPrice* newOrdersAtPrice) noexcept -> void;
         auto removeOrdersAtPrice(Side side, Price price) noexcept -> void;
         auto removeOrder(MarketOrder* order) noexcept -> void; 
     
         const TickerId _tickerId;
+        const InstrumentCfg _instrument;
         TradingEngine* _tradingEngine = nullptr;
         // hashmap to map orderId to order object
         OrderHashMap _oidToOrder;
         MemPool<MarketOrderAtPrice> _ordersAtPricePool;
         MemPool<MarketOrder> _orderPool;
-        MarketOrderAtPrice* _asksByPrice;
-        MarketOrderAtPrice* _bidsByPrice;
+        MarketOrderAtPrice* _asksByPrice = nullptr;
+        MarketOrderAtPrice* _bidsByPrice = nullptr;
         OrdersAtPriceHashMap _priceOrdersAtPrice;
         BBO _bbo;
         Logger* _logger;
         std::string _timeStr;
     };
 
-    typedef std::array<MarketOrderBook*, ME_MAX_TICKERS> MarketOrderBookHashMap;
+    typedef std::vector<MarketOrderBook*> MarketOrderBookHashMap;
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <vector>
 #include <sstream>
 #include "types.h"
 
@@ -13,7 +14,8 @@ namespace Trading {
         PENDING_NEW = 1, // order was sent but didnt receive confirmation yet
         LIVE = 2, // order is live
         PENDING_CANCEL = 3, // cancellation of order was sent but didnt receive confirmation yet
-        DEAD = 4
+        DEAD = 4,
+        PENDING_MODIFY = 5 // amend of a live order was sent but didnt receive confirmation yet
     };
 
     inline auto OMOrderStateToString(OMOrderState state) noexcept -> std::string {
@@ -29,6 +31,8 @@ namespace Trading {
             return "PENDING_CANCEL";
         case OMOrderState::DEAD:
             return "DEAD";
+        case OMOrderState::PENDING_MODIFY:
+            return "PENDING_MODIFY";
         }
 
         return "UNKNOWN";
@@ -59,5 +63,5 @@ namespace Trading {
     // array that holds the max ammount of sides in an order
     typedef std::array<OMOrder, sideToIndex(Side::Max) + 1> OMOrderSideHashMap;
     // array that holds the max ammount of side in an order for every ticker
-    typedef std::array<OMOrderSideHashMap, ME_MAX_TICKERS> OMOrderTickerSideHashMap;
+    typedef std::vector<OMOrderSideHashMap> OMOrderTickerSideHashMap;
 }
\ No newline at end of file
@@ -2,8 +2,8 @@
 
 
 namespace Trading {
-    OrderManager::OrderManager(Logger* logger, TradingEngine* tradingEngine, RiskManager& riskManager)
-    : _Logger(logger), _tradingEngine(tradingEngine), _riskManager(riskManager) {}
+    OrderManager::OrderManager(Logger* logger, TradingEngine* tradingEngine, RiskManager& riskManager, size_t numTickers)
+    : _Logger(logger), _tradingEngine(tradingEngine), _riskManager(riskManager), _tickerSideOrder(numTickers) {}
 
 
     auto OrderManager::newOrder(OMOrder* order, TickerId tickerId, Price price, Side side, Qty qty) noexcept -> void {
@@ -17,7 +17,7 @@ namespace Trading {
     }
 
     auto OrderManager::cancelOrder(OMOrder* order) noexcept -> void {
-        const Exchange::MEClientRequest cancelRequest{Exchange::ClientRequestType::NEW,  _tradingEngine->clientId(), order->tickerId, order->orderId, order->side, order->price, order->qty};
+        const Exchange::MEClientRequest cancelRequest{Exchange::ClientRequestType::CANCEL,  _tradingEngine->clientId(), order->tickerId, order->orderId, order->side, order->price, order->qty};
         
         _tradingEngine->sendClientRequest(&cancelRequest);
 
@@ -25,12 +25,50 @@ namespace Trading {
         _logger->log("%:% %() % Sent new order % for %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), cancelRequest.toString().c_str(), order->toString().c_str());
     }
 
+    auto OrderManager::modifyOrder(OMOrder* order, Price price, Qty qty) noexcept -> void {
+        const Exchange::MEClientRequest modifyRequest{Exchange::ClientRequestType::MODIFY,  _tradingEngine->clientId(), order->tickerId, order->orderId, order->side, price, qty};
+
+        _tradingEngine->sendClientRequest(&modifyRequest);
+
+        // price & qty are taken from the MODIFIED response, until then the order rests as it was
+        order->orderState = OMOrderState::PENDING_MODIFY;
+        _logger->log("%:% %() % Sent modify order % for %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), modifyRequest.toString().c_str(), order->toString().c_str());
+    }
+
+    auto OrderManager::quoteOrder(OMOrder* order, TickerId tickerId, Price price, Side side, Qty qty) noexcept -> void {
+        const bool live = (order->orderState == OMOrderState::LIVE);
+        if (price == Price_INVALID) {
+            if (!live)
+                return;
+            qty = 0;
+        } else if (live && order->price == price && order->qty == qty) {
+            return;
+        } else if (!live) {
+            const auto riskResult = _riskManager.checkPreTradeRisk(tickerId, side, qty);
+            if (UNLIKELY(riskResult != RiskCheckResult::ALLOWED)) {
+                _logger->log("%:% %() % Ticker:% Side:% Qty:% RiskCheckResult:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), tickerIdToString(tickerId), sideToString(side), qtyToString(qty), riskCheckResultToString(riskResult));
+                return;
+            }
+        }
+
+        const Exchange::MEClientRequest quoteRequest{Exchange::ClientRequestType::QUOTE,  _tradingEngine->clientId(), tickerId, _nextOrderId, side, price, qty};
+
+        _tradingEngine->sendClientRequest(&quoteRequest);
+
+        // the exchange replaces whatever quote it has, so a quote counts as live once sent & fills take its qty down
+        *order = {tickerId, _nextOrderId, side, price, qty, (qty ? OMOrderState::LIVE : OMOrderState::DEAD)};
+        _nextOrderId++;
+        _logger->log("%:% %() % Sent quote % for %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), quoteRequest.toString().c_str(), order->toString().c_str());
+    }
+
     auto OrderManager::moveOrder(OMOrder* order, TickerId tickerId, Price price, Side side, Qty qty) noexcept -> void {
         switch (order->orderState)
         {
         case OMOrderState::LIVE : {
-            if (order->price != price || order->qty != qty)
+            if (price == Price_INVALID)
                 cancelOrder(order);
+            else if (order->price != price || order->qty != qty)
+                modifyOrder(order, price, qty);
             break;
         }
         case OMOrderState::INVALID:
@@ -46,6 +84,7 @@ namespace Trading {
         } 
         case OMOrderState::PENDING_NEW:
         case OMOrderState::PENDING_CANCEL:
+        case OMOrderState::PENDING_MODIFY:
             break;
         }
     }
@@ -58,11 +97,21 @@ namespace Trading {
         moveOrder(askOrder, tickerId, bidPrice, Side::Sell, clip);
     }
 
+    auto OrderManager::quoteOrders(TickerId tickerId, Price bidPrice, Price askPrice, Qty clip) noexcept -> void {
+        auto& sideOrders = _tickerSideOrder.at(tickerId);
+        quoteOrder(&sideOrders.at(sideToIndex(Side::Buy)), tickerId, bidPrice, Side::Buy, clip);
+        quoteOrder(&sideOrders.at(sideToIndex(Side::Sell)), tickerId, askPrice, Side::Sell, clip);
+    }
+
     auto OrderManager::onOrderUpdate(const Exchange::MEClientResponse* clientResponse) noexcept -> void {
         _logger->log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), clientResponse->toString().c_str());
-        
-        auto order = &(ticker_side_order_.at(client_response->ticker_id_).at(sideToIndex(client_response->side_)));
-        _logger->log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), order->toString().c_str());
+
+        // the acks of a mass cancel or mass quote cover many orders, they may name no ticker or side of their own
+        OMOrder* order = nullptr;
+        if (clientResponse->tickerId < _tickerSideOrder.size() && clientResponse->side != Side::Invalid) {
+            order = &(ticker_side_order_.at(client_response->ticker_id_).at(sideToIndex(client_response->side_)));
+            _logger->log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), order->toString().c_str());
+        }
     
         switch (clientResponse->type) {
             case Exchange::ClientResponseType::ACCEPTED: {
@@ -79,6 +128,21 @@ namespace Trading {
                     order->orderState = OMOrderState::DEAD;
                 }
             break;
+            case Exchange::ClientResponseType::MODIFIED: {
+                order->price = clientResponse->price;
+                order->qty = clientResponse->leavesQty;
+                order->orderState = OMOrderState::LIVE;
+            }
+            break;
+            case Exchange::ClientResponseType::MODIFY_REJECTED: {
+                // the order rests as it was, unless it was filled or canceled in the meantime
+                if (order->orderState == OMOrderState::PENDING_MODIFY)
+                    order->orderState = OMOrderState::LIVE;
+            }
+            break;
+            // every order a mass cancel took out got its own CANCELED, quotes count as live since they were sent
+            case Exchange::ClientResponseType::MASS_CANCELED:
+            case Exchange::ClientResponseType::MASS_QUOTE_ACK:
             case Exchange::ClientResponseType::CANCEL_REJECTED:
             case Exchange::ClientResponseType::INVALID: {
             }
@@ -14,7 +14,7 @@ namespace Trading {
 
     class OrderManager {
     public:
-        OrderManager(Logger* logger, TradingEngine* tradingEngine, RiskManager& riskManager);
+        OrderManager(Logger* logger, TradingEngine* tradingEngine, RiskManager& riskManager, size_t numTickers);
         OrderManager() = delete;
         OrderManager(const OrderManager &) = delete;
         OrderManager(const OrderManager &&) = delete;
@@ -26,11 +26,18 @@ namespace Trading {
         }
 
         auto moveOrders(TickerId tickerId, Price bidPrice, Price askPrice, Qty clip) noexcept -> void;
+        // quotes both sides of tickerId instead, the order gateway packs the quotes sent back to back into one mass
+        // quote, a ticker is either quoted or traded with moveOrders() not both
+        auto quoteOrders(TickerId tickerId, Price bidPrice, Price askPrice, Qty clip) noexcept -> void;
         auto onOrderUpdate(const Exchange::MEClientResponse* clientResponse) noexcept -> void;
     private:
         auto moveOrder(OMOrder* order, TickerId tickerId, Price price, Side side, Qty qty) noexcept -> void;
         auto newOrder(OMOrder* order, TickerId tickerId, Price price, Side side, Qty qty) noexcept -> void;
         auto cancelOrder(OMOrder* order) noexcept -> void;
+        // amends price & qty of a live order in one request instead of a cancel followed by a new order
+        auto modifyOrder(OMOrder* order, Price price, Qty qty) noexcept -> void;
+        // replaces the quote on the side of order, Price_INVALID pulls it
+        auto quoteOrder(OMOrder* order, TickerId tickerId, Price price, Side side, Qty qty) noexcept -> void;
         
         
         TradingEngine* _tradingEngine = nulltpr;
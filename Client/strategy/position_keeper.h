@@ -104,7 +104,7 @@ namespace Trading {
 
     class PositionKeeper {
     public:
-        PositionKeeper(Common::Logger* logger) : _logger(logger) {} 
+        PositionKeeper(Common::Logger* logger, size_t numTickers) : _logger(logger), _tickerPositions(numTickers) {} 
         
         PositionKeeper() = delete;
         PositionKeeper(const PositionKeeper &) = delete;
@@ -143,7 +143,8 @@ namespace Trading {
     private:
         std::string _timeStr;
         Common::Logger* _logger = nullptr;
-        std::array<PositionInfo, ME_MAX_TICKERS> _tickerPositions;
+        // positions of every listed ticker
+        std::vector<PositionInfo> _tickerPositions;
 
     };
 }
\ No newline at end of file
@@ -61,13 +61,13 @@ namespace Trading {
     };
 
     // array that holds info for performing risk checks for all available trading instruments
-    typedef std::array<RiskInfo, ME_MAX_TICKERS> TickerRiskInfoHashMap;
+    typedef std::vector<RiskInfo> TickerRiskInfoHashMap;
 
 
     class RiskManager {
     public:
-        RiskManager(Logger* logger, const PositionKeeper* positionKeeper, const TradingEngineCfgHashMap& tickerCfg) : _logger(logger) {
-            for(TickerId i = 0; i < ME_MAX_TICKERS; i++) {
+        RiskManager(Logger* logger, const PositionKeeper* positionKeeper, const TradingEngineCfgHashMap& tickerCfg) : _logger(logger), _tickerRisk(tickerCfg.size()) {
+            for(TickerId i = 0; i < tickerCfg.size(); i++) {
                 _tickerRisk.at(i).positionInfo = positionKeeper->getPositionInfo(i);
                 _tickerRisk.at(i).riskCfg = tickerCfg[i].riskCfg;
             }
@@ -1,15 +1,17 @@
 #include "trading_engine.h"
 
 namespace Trading {
-    TradingEngine::TradingEngine(ClientId clientId, AlgoType algoType, const TradingEngineCfgHashMap& tickerCfg, Exchange::ClientRequestLFQueue* clientRequests,
+    TradingEngine::TradingEngine(ClientId clientId, AlgoType algoType, const InstrumentRegistry& instruments, const TradingEngineCfgHashMap& tickerCfg, Exchange::ClientRequestLFQueue* clientRequests,
     Exchange::ClientResponseLFQueue* clientResponse, Exchange::MEMarketUpdateLFQueue* marketUpdates) 
     : _clientId(clientId), _outgoingOgwRequests(clientRequests), _incomingOgwResponses(clientResponse), 
     _incomingMdUpdates(marketUpdates), _logger("trading_engine_" + std::to_string(clientId) + ".log"),
-    _featureEngine(&_logger), _positionKeeper(&_logger), _riskManager(&_logger, &_positionKeeper, tickerCfg), _orderManager(&_logger, this, _riskManager) {
-        for (size_t i = 0; i < _tickerOrderBook.size() ; i++)
+    _featureEngine(&_logger), _positionKeeper(&_logger, instruments.size()), _riskManager(&_logger, &_positionKeeper, tickerCfg), _orderManager(&_logger, this, _riskManager, instruments.size()) {
+        ASSERT(tickerCfg.size() == instruments.size(), "Expected a TradingEngineCfg per instrument, got:" + std::to_string(tickerCfg.size()) + " for:" + std::to_string(instruments.size()));
+        _tickerOrderBook.reserve(instruments.size());
+        for (const auto& instrument : instruments)
         {
-            _tickerOrderBook[i] = new MarketOrderBook(i, &_logger);
-            _tickerOrderBook[i]->setTradingEngine(this);
+            _tickerOrderBook.push_back(new MarketOrderBook(instrument, &_logger));
+            _tickerOrderBook.back()->setTradingEngine(this);
         }
         
 
@@ -19,7 +19,8 @@
 namespace Trading {
     class TradingEngine {
     public:
-        TradingEngine(ClientId clientId, AlgoType algoType, const TradingEngineCfgHashMap& tickerCfg, Exchange::ClientRequestLFQueue* clientRequests,
+        // books & positions are kept for every instrument of the registry, tickerCfg holds one entry per instrument
+        TradingEngine(ClientId clientId, AlgoType algoType, const InstrumentRegistry& instruments, const TradingEngineCfgHashMap& tickerCfg, Exchange::ClientRequestLFQueue* clientRequests,
         Exchange::ClientResponseLFQueue* clientResponse, Exchange::MEMarketUpdateLFQueue* marketUpdates);
 
         ~TradingEngine();
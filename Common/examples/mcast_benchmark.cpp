@@ -0,0 +1,61 @@
+#include "time_utils.h"
+#include "logging.h"
+#include "mcast_socket.h"
+
+// measures market data throughput over multicast on loopback: the publisher queues a burst of updates, one datagram
+// each, that go out with sendmmsg() and the consumer drains them with recvmmsg() or from a packet ring, both driven
+// from the same thread
+int main(int, char **) {
+    using namespace Common;
+
+    Logger logger("mcast_benchmark.log");
+
+    const std::string iface = "lo";
+    const std::string ip = "239.0.0.1";
+    const size_t updateSize = 40; // roughly a market update
+    const size_t numUpdates = 100 * 1000;
+
+    int port = 20500;
+    for (const auto backend : {McastBackend::SOCKET, McastBackend::PACKET_RING}) {
+        for (const size_t burst : {1, 16, 64}) {
+            McastSocket publisher(logger);
+            ASSERT(publisher.init(ip, iface, port, false) >= 0, "Unable to create publisher, error: " + std::string(strerror(errno)));
+            McastSocket consumer(logger);
+            consumer.backend = backend;
+            ASSERT(consumer.init(ip, iface, port, true) >= 0, "Unable to create consumer, error: " + std::string(strerror(errno)));
+            ASSERT(consumer.join(ip), "Join failed, error: " + std::string(strerror(errno)));
+
+            size_t received = 0;
+            auto onRecv = [&received](McastSocket* socket, Nanos) {
+                received += socket->next_recv_valid_index / updateSize;
+            };
+
+            char update[updateSize] = {};
+            size_t sent = 0;
+            const auto start = getCurrentNanos();
+            while (sent < numUpdates) {
+                for (size_t i = 0; i < burst; i++) {
+                    publisher.send(update, updateSize);
+                    publisher.endDatagram();
+                }
+                publisher.sendAndRecv();
+                sent += burst;
+                consumer.sendAndRecv(onRecv);
+            }
+
+            // the ring hands over a block that is not full after PacketRingBlockTimeoutMs, nothing for longer than
+            // a few of those means whatever is missing was dropped
+            for (auto lastRecv = getCurrentNanos(); received < sent && getCurrentNanos() - lastRecv < 10 * NANOS_TO_MILLS;) {
+                if (consumer.sendAndRecv(onRecv))
+                    lastRecv = getCurrentNanos();
+            }
+            const auto elapsed = getCurrentNanos() - start;
+
+            std::cout << "backend:" << mcastBackendToString(backend) << " burst:" << burst << " updates/sec:" << received * NANOS_TO_SEC / elapsed
+                      << " received:" << received << " of:" << sent << std::endl;
+            port++;
+        }
+    }
+
+    return 0;
+}
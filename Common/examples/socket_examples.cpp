@@ -10,10 +10,10 @@ int main(int, char **) {
 
     auto tcpServerRecvCallback = [&](TCPSocket *socket, Nanos rx_time) noexcept {
         logger.log("TCPServer::defaultRecvCallback() socket:% len:% rx:%\n",
-        socket->fd, socket->next_recv_valid_index, rx_time);
+        socket->fd, socket->recvSize(), rx_time);
 
-        const std::string reply = "TCPServer received msg:" + std::string(socket->recv_buffer.data(), socket->next_recv_valid_index);
-        socket->next_recv_valid_index = 0;
+        const std::string reply = "TCPServer received msg:" + std::string(socket->recvData(), socket->recvSize());
+        socket->commitRecv(socket->recvSize());
 
         socket->send(reply.data(), reply.length());
     };
@@ -23,11 +23,11 @@ int main(int, char **) {
     };
 
     auto tcpClientRecvCallback = [&](TCPSocket *socket, Nanos rx_time) noexcept {
-        const std::string recv_msg = std::string(socket->recv_buffer.data(), socket->next_recv_valid_index);
-        socket->next_recv_valid_index = 0;
+        const std::string recv_msg = std::string(socket->recvData(), socket->recvSize());
+        socket->commitRecv(socket->recvSize());
 
         logger.log("TCPSocket::defaultRecvCallback() socket:% len:% rx:% msg:%\n",
-        socket->fd, socket->next_recv_valid_index, rx_time, recv_msg);
+        socket->fd, socket->recvSize(), rx_time, recv_msg);
     };
 
     const std::string iface = "lo";
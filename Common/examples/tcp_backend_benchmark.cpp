@@ -0,0 +1,70 @@
+#include "time_utils.h"
+#include "logging.h"
+#include "tcp_server.h"
+
+// compares TCPServer backends on loopback: every round each client sends one message, the server echoes it back
+// and the round ends once all clients got their echo, so the server handles numClients reads & sends per round
+// server and clients are driven from the same thread, so the numbers reflect cpu (mostly syscall) cost per message
+// rather than scheduling between busy threads
+int main(int, char **) {
+    using namespace Common;
+
+    Logger logger("tcp_backend_benchmark.log");
+    Logger serverLogger("tcp_backend_benchmark_server.log");
+
+    const std::string iface = "lo";
+    const std::string ip = "127.0.0.1";
+    const size_t msgSize = 48; // roughly a client request
+    const size_t numRounds = 2 * 1000;
+
+    int port = 12347;
+    for (const auto backend : {TCPBackend::EPOLL, TCPBackend::IO_URING, TCPBackend::IO_URING_SQPOLL}) {
+        for (const size_t numClients : {1, 16, 64}) {
+            TCPServer server(serverLogger, backend);
+            server.recv_callback = [](TCPSocket *socket, Nanos) noexcept {
+                socket->send(socket->recvData(), socket->recvSize());
+                socket->commitRecv(socket->recvSize());
+            };
+            server.recv_finished_callback = []() noexcept {};
+            server.listen(iface, port);
+
+            size_t bytesReceived = 0;
+            std::vector<TCPSocket*> clients;
+            for (size_t i = 0; i < numClients; i++) {
+                auto client = new TCPSocket(logger);
+                ASSERT(client->connect(ip, iface, port, false) >= 0, "Unable to connect, error: " + std::string(strerror(errno)));
+                client->recv_callback = [&bytesReceived](TCPSocket *socket, Nanos) noexcept {
+                    bytesReceived += socket->recvSize();
+                    socket->commitRecv(socket->recvSize());
+                };
+                clients.push_back(client);
+            }
+
+            char msg[msgSize] = {};
+            const auto start = getCurrentNanos();
+            for (size_t round = 1; round <= numRounds; round++) {
+                for (auto client : clients) {
+                    client->send(msg, msgSize);
+                    client->flush();
+                }
+                while (bytesReceived < round * numClients * msgSize) {
+                    server.poll();
+                    server.sendAndRecv();
+                    for (auto client : clients)
+                        client->sendAndRecv();
+                }
+            }
+            const auto elapsed = getCurrentNanos() - start;
+
+            std::cout << "backend:" << tcpBackendToString(backend) << " clients:" << numClients
+                      << " msgs/sec:" << numRounds * numClients * NANOS_TO_SEC / elapsed
+                      << " ns/round:" << elapsed / static_cast<Nanos>(numRounds) << std::endl;
+
+            for (auto client : clients)
+                delete client;
+            port++;
+        }
+    }
+
+    return 0;
+}
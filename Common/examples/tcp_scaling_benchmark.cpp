@@ -0,0 +1,81 @@
+#include <sys/resource.h>
+#include "time_utils.h"
+#include "logging.h"
+#include "tcp_server.h"
+
+// measures what one message costs TCPServer as the number of mostly idle sessions grows: every round one session
+// sends a message, the server echoes it and the round ends once the echo is read back, the cost should stay flat
+int main(int, char **) {
+    using namespace Common;
+
+    Logger logger("tcp_scaling_benchmark.log");
+
+    const std::string iface = "lo";
+    const std::string ip = "127.0.0.1";
+    const size_t msgSize = 48; // roughly a client request
+    const size_t numRounds = 20 * 1000;
+
+    // every session needs a client and a server fd
+    rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    const size_t maxSessions = (limit.rlim_cur - 64) / 2;
+
+    int port = 12400;
+    for (const auto backend : {TCPBackend::EPOLL, TCPBackend::IO_URING}) {
+        for (size_t numSessions : {100, 1000, 10000}) {
+            if (numSessions > maxSessions) {
+                std::cout << "fd limit " << limit.rlim_cur << " allows " << maxSessions << " sessions instead of " << numSessions << std::endl;
+                numSessions = maxSessions;
+            }
+
+            TCPServer server(logger, backend);
+            server.recv_callback = [](TCPSocket *socket, Nanos) noexcept {
+                socket->send(socket->recvData(), socket->recvSize());
+                socket->commitRecv(socket->recvSize());
+            };
+            server.recv_finished_callback = []() noexcept {};
+            server.listen(iface, port);
+
+            // connect in batches that fit the listen backlog
+            std::vector<int> clients;
+            while (clients.size() < numSessions) {
+                for (size_t i = 0; i < 256 && clients.size() < numSessions; i++)
+                    clients.push_back(createSocket(logger, ip, iface, port, false, false, false, 0, false));
+                while (server.sockets.size() < clients.size()) {
+                    server.poll();
+                    server.sendAndRecv();
+                }
+            }
+
+            char msg[msgSize] = {};
+            char echo[msgSize];
+            const auto start = getCurrentNanos();
+            for (size_t round = 0; round < numRounds; round++) {
+                // spread the active session over all of them
+                const auto client = clients[(round * 7919) % clients.size()];
+                ASSERT(::send(client, msg, msgSize, MSG_NOSIGNAL) == static_cast<ssize_t>(msgSize), "send() failed, error: " + std::string(strerror(errno)));
+
+                size_t received = 0;
+                while (received < msgSize) {
+                    server.poll();
+                    server.sendAndRecv();
+                    const auto n = ::recv(client, echo, msgSize - received, MSG_DONTWAIT);
+                    if (n > 0)
+                        received += n;
+                }
+            }
+            const auto elapsed = getCurrentNanos() - start;
+
+            std::cout << "backend:" << tcpBackendToString(backend) << " sessions:" << numSessions
+                      << " ns/msg:" << elapsed / static_cast<Nanos>(numRounds) << std::endl;
+
+            for (auto client : clients)
+                close(client);
+            port++;
+        }
+    }
+
+    return 0;
+}
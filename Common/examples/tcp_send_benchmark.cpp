@@ -0,0 +1,68 @@
+#include "time_utils.h"
+#include "logging.h"
+#include "tcp_server.h"
+
+// measures how many fixed size responses per second a single session can push through TCPSocket on loopback
+int main(int, char **) {
+    using namespace Common;
+
+    Logger logger("tcp_send_benchmark.log");
+    Logger serverLogger("tcp_send_benchmark_server.log");
+
+    const std::string iface = "lo";
+    const std::string ip = "127.0.0.1";
+    const int port = 12346;
+    const size_t msgSize = 48; // roughly a sequenced client response
+    const size_t numMsgs = 500 * 1000;
+
+    std::atomic<size_t> bytesReceived = {0};
+
+    TCPServer server(serverLogger);
+    server.recv_callback = [&](TCPSocket *socket, Nanos) noexcept {
+        bytesReceived += socket->recvSize();
+        socket->commitRecv(socket->recvSize());
+    };
+    server.recv_finished_callback = []() noexcept {};
+    server.listen(iface, port);
+
+    volatile bool run = true;
+    // createAndStartThread() keeps a reference to the function, so it has to outlive the thread
+    auto serve = [&]() {
+        while (run) {
+            server.poll();
+            server.sendAndRecv();
+        }
+    };
+    auto serverThread = createAndStartThread(-1, "TCPSendBenchmark/Server", serve);
+
+    char msg[msgSize] = {};
+    for (const bool zeroCopy : {false, true}) {
+        for (const size_t batch : {1, 16, 256, 4096}) {
+            TCPSocket client(logger);
+            ASSERT(client.connect(ip, iface, port, false) >= 0, "Unable to connect, error: " + std::string(strerror(errno)));
+            if (zeroCopy && !client.enableZeroCopy()) {
+                std::cout << "SO_ZEROCOPY not supported" << std::endl;
+                break;
+            }
+
+            bytesReceived = 0;
+            const auto start = getCurrentNanos();
+            for (size_t sent = 0; sent < numMsgs; sent += batch) {
+                // a loop's worth of responses goes out with a single flush
+                for (size_t i = 0; i < batch; i++)
+                    client.send(msg, msgSize);
+                client.flush();
+            }
+            while (client.sendSize())
+                client.flush();
+            while (bytesReceived < numMsgs * msgSize);
+            const auto elapsed = getCurrentNanos() - start;
+
+            std::cout << "zero-copy:" << zeroCopy << " batch:" << batch << " msgs/sec:" << numMsgs * NANOS_TO_SEC / elapsed << std::endl;
+        }
+    }
+
+    run = false;
+    serverThread->join();
+    return 0;
+}
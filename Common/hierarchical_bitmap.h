@@ -0,0 +1,114 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <vector>
+#include "macros.h"
+
+namespace Common {
+    // set of the integers [0, size) as a tree of 64 bit words: a bit of a word above is set when the word it stands
+    // for below has any bit set, so the lowest / highest member or the next one up / down from a position is found
+    // with a tzcnt / lzcnt per layer instead of a scan
+    class HierarchicalBitmap final {
+    public:
+        static constexpr size_t NONE = static_cast<size_t>(-1);
+
+        explicit HierarchicalBitmap(size_t size) : _size(size) {
+            do {
+                size = (size + 63) / 64;
+                _layers.emplace_back(size, 0);
+            } while (size > 1);
+        }
+
+        HierarchicalBitmap() = delete;
+        HierarchicalBitmap(const HierarchicalBitmap&) = delete;
+        HierarchicalBitmap(const HierarchicalBitmap&&) = delete;
+        HierarchicalBitmap& operator=(const HierarchicalBitmap&) = delete;
+        HierarchicalBitmap& operator=(const HierarchicalBitmap&&) = delete;
+
+        auto set(size_t i) noexcept -> void {
+            for (auto& layer : _layers) {
+                const auto was = layer[i / 64];
+                layer[i / 64] |= bit(i);
+                if (was)
+                    return;
+                i /= 64;
+            }
+        }
+
+        auto clear(size_t i) noexcept -> void {
+            for (auto& layer : _layers) {
+                layer[i / 64] &= ~bit(i);
+                if (layer[i / 64])
+                    return;
+                i /= 64;
+            }
+        }
+
+        auto test(size_t i) const noexcept -> bool {
+            return _layers[0][i / 64] & bit(i);
+        }
+
+        auto empty() const noexcept -> bool {
+            return !_layers.back()[0];
+        }
+
+        // function for the lowest member, NONE if there is none
+        auto lowest() const noexcept -> size_t {
+            return empty() ? NONE : descendLowest(_layers.size() - 1, static_cast<size_t>(std::countr_zero(_layers.back()[0])));
+        }
+
+        // function for the highest member, NONE if there is none
+        auto highest() const noexcept -> size_t {
+            return empty() ? NONE : descendHighest(_layers.size() - 1, 63 - static_cast<size_t>(std::countl_zero(_layers.back()[0])));
+        }
+
+        // function for the lowest member above i, NONE if there is none
+        auto above(size_t i) const noexcept -> size_t {
+            // climb until a word has a member past the position we came from, then take the lowest below it
+            for (size_t layer = 0; layer < _layers.size(); layer++, i /= 64) {
+                const auto word = (i % 64 == 63 ? 0 : _layers[layer][i / 64] & (~uint64_t{0} << (i % 64 + 1)));
+                if (word)
+                    return descendLowest(layer, (i / 64) * 64 + static_cast<size_t>(std::countr_zero(word)));
+            }
+            return NONE;
+        }
+
+        // function for the highest member below i, NONE if there is none
+        auto below(size_t i) const noexcept -> size_t {
+            for (size_t layer = 0; layer < _layers.size(); layer++, i /= 64) {
+                const auto word = _layers[layer][i / 64] & (bit(i) - 1);
+                if (word)
+                    return descendHighest(layer, (i / 64) * 64 + 63 - static_cast<size_t>(std::countl_zero(word)));
+            }
+            return NONE;
+        }
+
+        auto size() const noexcept -> size_t {
+            return _size;
+        }
+
+    private:
+        static auto bit(size_t i) noexcept -> uint64_t {
+            return uint64_t{1} << (i % 64);
+        }
+
+        // follows the lowest set bits down from bit i of layer to a member
+        auto descendLowest(size_t layer, size_t i) const noexcept -> size_t {
+            while (layer-- > 0)
+                i = i * 64 + static_cast<size_t>(std::countr_zero(_layers[layer][i]));
+            return i;
+        }
+
+        // follows the highest set bits down from bit i of layer to a member
+        auto descendHighest(size_t layer, size_t i) const noexcept -> size_t {
+            while (layer-- > 0)
+                i = i * 64 + 63 - static_cast<size_t>(std::countl_zero(_layers[layer][i]));
+            return i;
+        }
+
+        size_t _size = 0;
+        // _layers[0] holds a bit per member, the last layer a single word
+        std::vector<std::vector<uint64_t>> _layers;
+    };
+}
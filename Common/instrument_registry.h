@@ -0,0 +1,118 @@
+#pragma once
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "macros.h"
+#include "types.h"
+
+namespace Common {
+    // limits of an instrument the exchange & trading side size their books, snapshot state and positions to
+    struct InstrumentCfg {
+        TickerId tickerId = TickerId_INVALID;
+        std::string symbol;
+        Price tickSize = 1;
+        // prices orders are expected within, price levels are indexed relative to minPrice
+        Price minPrice = 0;
+        Price maxPrice = 0;
+        // price levels tracked at once & most orders live at once, order ids keep growing past maxOrders and are looked
+        // up through a hash index rather than used as positions
+        size_t maxPriceLevels = 0;
+        size_t maxOrders = 0;
+
+        // index of the price level slot for price, levels maxPriceLevels ticks apart share a slot
+        auto priceToIndex(Price price) const noexcept -> size_t {
+            return static_cast<size_t>((price - minPrice) / tickSize) % maxPriceLevels;
+        }
+
+        auto toString() const noexcept -> std::string {
+            std::stringstream ss;
+            ss << "InstrumentCfg{"
+            << "ticker:" << tickerIdToString(tickerId) << " "
+            << "symbol:" << symbol << " "
+            << "tick:" << priceToString(tickSize) << " "
+            << "band:[" << priceToString(minPrice) << "," << priceToString(maxPrice) << "] "
+            << "levels:" << maxPriceLevels << " "
+            << "orders:" << maxOrders
+            << "}";
+            return ss.str();
+        }
+    };
+
+    // instruments listed, loaded once at startup, ticker ids are the positions in the registry
+    class InstrumentRegistry {
+    public:
+        InstrumentRegistry() = default;
+
+        // method for listing an instrument, returns its ticker id
+        auto add(InstrumentCfg cfg) noexcept -> TickerId {
+            ASSERT(cfg.tickSize > 0 && cfg.maxPriceLevels > 0 && cfg.maxOrders > 0, "Invalid instrument " + cfg.toString());
+            // the band and order ids have to stay clear of the INVALID values of the types the build uses
+            ASSERT(cfg.minPrice <= cfg.maxPrice && cfg.maxPrice < Price_INVALID && cfg.minPrice > -Price_INVALID && cfg.maxOrders < OrderId_INVALID,
+                   "Instrument does not fit the scalar widths of this build " + cfg.toString());
+            cfg.tickerId = static_cast<TickerId>(_instruments.size());
+            _instruments.push_back(cfg);
+            return cfg.tickerId;
+        }
+
+        auto size() const noexcept -> size_t {
+            return _instruments.size();
+        }
+
+        auto at(TickerId tickerId) const noexcept -> const InstrumentCfg& {
+            return _instruments[tickerId];
+        }
+
+        // function for finding the ticker id of symbol, TickerId_INVALID if it is not listed
+        auto find(const std::string& symbol) const noexcept -> TickerId {
+            for (const auto& cfg : _instruments) {
+                if (cfg.symbol == symbol)
+                    return cfg.tickerId;
+            }
+            return TickerId_INVALID;
+        }
+
+        auto begin() const noexcept {
+            return _instruments.begin();
+        }
+
+        auto end() const noexcept {
+            return _instruments.end();
+        }
+
+        // function for loading a registry from a file with a line per instrument:
+        // symbol tick_size min_price max_price max_price_levels max_orders
+        // empty lines and lines starting with # are skipped
+        static auto load(const std::string& path) noexcept -> InstrumentRegistry {
+            std::ifstream file(path);
+            ASSERT(file.is_open(), "Unable to open instrument registry:" + path);
+
+            InstrumentRegistry registry;
+            std::string line;
+            while (std::getline(file, line)) {
+                if (line.empty() || line[0] == '#')
+                    continue;
+
+                std::istringstream fields(line);
+                InstrumentCfg cfg;
+                fields >> cfg.symbol >> cfg.tickSize >> cfg.minPrice >> cfg.maxPrice >> cfg.maxPriceLevels >> cfg.maxOrders;
+                ASSERT(!fields.fail(), "Malformed instrument registry line:" + line);
+                registry.add(cfg);
+            }
+
+            return registry;
+        }
+
+        // function for the instruments listed when no registry is given, the limits the system had built in
+        static auto defaults() noexcept -> InstrumentRegistry {
+            InstrumentRegistry registry;
+            for (size_t i = 0; i < 8; i++)
+                registry.add({TickerId_INVALID, "TICKER" + std::to_string(i), 1, 0, 256, 256, 1024 * 1024});
+            return registry;
+        }
+
+    private:
+        std::vector<InstrumentCfg> _instruments;
+    };
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "macros.h"
+
+namespace Common {
+    // minimal io_uring on top of the raw syscalls, submission and completion rings are not thread safe
+    // so every thread driving sockets through io_uring needs its own IoUring
+    class IoUring final {
+    public:
+        // with sq_poll a kernel thread picks up submissions, so submitting does not need a syscall while it is awake
+        explicit IoUring(unsigned entries, bool sq_poll = false) : _sqPoll(sq_poll) {
+            io_uring_params params = {};
+            if (sq_poll) {
+                params.flags |= IORING_SETUP_SQPOLL;
+                params.sq_thread_idle = 1000; // ms the kernel thread spins before it needs a wakeup
+            }
+
+            _fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+            ASSERT(_fd >= 0, "io_uring_setup() failed, error: " + std::string(strerror(errno)));
+            ASSERT(params.features & IORING_FEAT_SINGLE_MMAP, "io_uring without IORING_FEAT_SINGLE_MMAP is not supported.");
+
+            // submission and completion rings share one mapping, the sqe array has its own
+            _ringSize = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned), params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+            _ring = static_cast<char*>(mmap(nullptr, _ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING));
+            ASSERT(_ring != MAP_FAILED, "mmap() of io_uring rings failed, error: " + std::string(strerror(errno)));
+            _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            _sqes = static_cast<io_uring_sqe*>(mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES));
+            ASSERT(_sqes != MAP_FAILED, "mmap() of io_uring sqes failed, error: " + std::string(strerror(errno)));
+
+            _sqHead = reinterpret_cast<unsigned*>(_ring + params.sq_off.head);
+            _sqTail = reinterpret_cast<unsigned*>(_ring + params.sq_off.tail);
+            _sqFlags = reinterpret_cast<unsigned*>(_ring + params.sq_off.flags);
+            _sqMask = *reinterpret_cast<unsigned*>(_ring + params.sq_off.ring_mask);
+            _sqEntries = params.sq_entries;
+            _cqHead = reinterpret_cast<unsigned*>(_ring + params.cq_off.head);
+            _cqTail = reinterpret_cast<unsigned*>(_ring + params.cq_off.tail);
+            _cqMask = *reinterpret_cast<unsigned*>(_ring + params.cq_off.ring_mask);
+            _cqes = reinterpret_cast<io_uring_cqe*>(_ring + params.cq_off.cqes);
+
+            // sqes are always used in ring order, so the indirection array is set up once
+            auto sqArray = reinterpret_cast<unsigned*>(_ring + params.sq_off.array);
+            for (unsigned i = 0; i < _sqEntries; i++)
+                sqArray[i] = i;
+        }
+
+        ~IoUring() {
+            if (_bufRing) {
+                munmap(_bufRing, _numBuffers * sizeof(io_uring_buf));
+                munmap(_buffers, _numBuffers * _bufferSize);
+            }
+            munmap(_sqes, _sqesSize);
+            munmap(_ring, _ringSize);
+            close(_fd);
+            _fd = -1;
+        }
+
+        IoUring() = delete;
+        IoUring(const IoUring&) = delete;
+        IoUring(const IoUring&&) = delete;
+        IoUring& operator=(const IoUring&) = delete;
+        IoUring& operator=(const IoUring&&) = delete;
+
+        // next free submission entry, zeroed, submits what is queued first if the ring is full
+        auto getSqe() noexcept -> io_uring_sqe* {
+            while (UNLIKELY(_sqeTail - std::atomic_ref<unsigned>(*_sqHead).load(std::memory_order_acquire) >= _sqEntries))
+                submit();
+
+            auto sqe = &_sqes[_sqeTail++ & _sqMask];
+            memset(sqe, 0, sizeof(*sqe));
+            return sqe;
+        }
+
+        // hands the queued entries to the kernel, only enters the kernel if there is something to submit
+        // or the sq poll thread went to sleep
+        auto submit() noexcept -> void {
+            const auto toSubmit = _sqeTail - _sqeSubmitted;
+            _sqeSubmitted = _sqeTail;
+            std::atomic_ref<unsigned>(*_sqTail).store(_sqeTail, std::memory_order_release);
+
+            // the tail store has to be visible before we look at whether the sq poll thread sleeps
+            if (_sqPoll)
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            const auto sqFlags = std::atomic_ref<unsigned>(*_sqFlags).load(std::memory_order_relaxed);
+
+            unsigned flags = 0;
+            // completions the completion ring had no room for are only flushed to it by entering the kernel
+            if (UNLIKELY(sqFlags & IORING_SQ_CQ_OVERFLOW))
+                flags |= IORING_ENTER_GETEVENTS;
+            if (_sqPoll && (sqFlags & IORING_SQ_NEED_WAKEUP))
+                flags |= IORING_ENTER_SQ_WAKEUP;
+            if (LIKELY(!flags && (_sqPoll || !toSubmit)))
+                return;
+
+            const auto rc = syscall(__NR_io_uring_enter, _fd, toSubmit, 0, flags, nullptr, 0);
+            ASSERT(rc >= 0 || errno == EAGAIN || errno == EBUSY || errno == EINTR, "io_uring_enter() failed, error: " + std::string(strerror(errno)));
+        }
+
+        // calls f with every available completion and marks them as seen, returns the number of completions
+        template<typename F>
+        auto forEachCompletion(F&& f) noexcept -> unsigned {
+            auto head = *_cqHead;
+            const auto tail = std::atomic_ref<unsigned>(*_cqTail).load(std::memory_order_acquire);
+            const auto n = tail - head;
+            for (; head != tail; head++)
+                f(&_cqes[head & _cqMask]);
+            std::atomic_ref<unsigned>(*_cqHead).store(head, std::memory_order_release);
+            return n;
+        }
+
+        // registers num_buffers (power of 2) buffers of buffer_size bytes the kernel picks from for IOSQE_BUFFER_SELECT reads
+        auto setupBufferRing(unsigned num_buffers, size_t buffer_size) noexcept -> void {
+            ASSERT(!_bufRing && num_buffers && !(num_buffers & (num_buffers - 1)) && num_buffers <= 32768, "Invalid io_uring buffer ring size:" + std::to_string(num_buffers));
+            _numBuffers = num_buffers;
+            _bufferSize = buffer_size;
+
+            _bufRing = static_cast<io_uring_buf_ring*>(mmap(nullptr, _numBuffers * sizeof(io_uring_buf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+            ASSERT(_bufRing != MAP_FAILED, "mmap() of io_uring buffer ring failed, error: " + std::string(strerror(errno)));
+            _buffers = static_cast<char*>(mmap(nullptr, _numBuffers * _bufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0));
+            ASSERT(_buffers != MAP_FAILED, "mmap() of io_uring buffers failed, error: " + std::string(strerror(errno)));
+
+            io_uring_buf_reg reg = {};
+            reg.ring_addr = reinterpret_cast<__u64>(_bufRing);
+            reg.ring_entries = _numBuffers;
+            reg.bgid = BufferGroup;
+            ASSERT(syscall(__NR_io_uring_register, _fd, IORING_REGISTER_PBUF_RING, &reg, 1) == 0, "IORING_REGISTER_PBUF_RING failed, error: " + std::string(strerror(errno)));
+
+            for (unsigned bid = 0; bid < _numBuffers; bid++)
+                recycleBuffer(bid);
+        }
+
+        auto hasBufferRing() const noexcept -> bool {
+            return (_bufRing != nullptr);
+        }
+
+        // buffer the kernel filled for a completion carrying IORING_CQE_F_BUFFER
+        auto buffer(unsigned bid) const noexcept -> char* {
+            return _buffers + bid * _bufferSize;
+        }
+
+        // gives a buffer back to the kernel once its contents were consumed
+        auto recycleBuffer(unsigned bid) noexcept -> void {
+            // not _bufRing->bufs, in C++ the flex array macro of the uapi header puts it 8 bytes past the ring start
+            auto& buf = reinterpret_cast<io_uring_buf*>(_bufRing)[_bufTail & (_numBuffers - 1)];
+            buf.addr = reinterpret_cast<__u64>(buffer(bid));
+            buf.len = static_cast<__u32>(_bufferSize);
+            buf.bid = static_cast<__u16>(bid);
+            std::atomic_ref<__u16>(_bufRing->tail).store(++_bufTail, std::memory_order_release);
+        }
+
+        static constexpr __u16 BufferGroup = 0;
+
+    private:
+        int _fd = -1;
+        const bool _sqPoll = false;
+
+        char* _ring = nullptr;
+        size_t _ringSize = 0;
+        io_uring_sqe* _sqes = nullptr;
+        size_t _sqesSize = 0;
+
+        unsigned *_sqHead = nullptr, *_sqTail = nullptr, *_sqFlags = nullptr;
+        unsigned _sqMask = 0, _sqEntries = 0;
+        // sqes handed out and sqes already made visible to the kernel
+        unsigned _sqeTail = 0, _sqeSubmitted = 0;
+
+        unsigned *_cqHead = nullptr, *_cqTail = nullptr;
+        unsigned _cqMask = 0;
+        io_uring_cqe* _cqes = nullptr;
+
+        io_uring_buf_ring* _bufRing = nullptr;
+        char* _buffers = nullptr;
+        unsigned _numBuffers = 0;
+        size_t _bufferSize = 0;
+        __u16 _bufTail = 0;
+    };
+}
@@ -2,44 +2,113 @@
 
 namespace Common {
     auto McastSocket::init(const std::string &ip, const std::string &iface,const int port, bool is_listening) noexcept -> int {
-        socketFd = createSocket(logger, ip, iface, port, true, false, is_listening, 0, false);
+        // receivers timestamp datagrams so wire to app latency can be measured
+        socketFd = createSocket(logger, ip, iface, port, true, false, is_listening, 0, is_listening, busy_poll);
+        ifaceIp = iface.empty() ? "" : getIfaceIP(iface);
+
+        if (is_listening && backend == McastBackend::PACKET_RING && socketFd >= 0) {
+            // the ring sees the datagrams first, queueing them on the socket as well would only cost
+            ASSERT(setDropAll(socketFd), "setDropAll() failed, error: " + std::string(strerror(errno)));
+            delete packet_ring;
+            packet_ring = new PacketRing(logger, iface, port);
+        }
         return socketFd;
     }
 
     auto McastSocket::join(const std::string &ip) -> bool {
-        return Common::join(socketFd, ip);
+        if (packet_ring)
+            packet_ring->addGroup(ip);
+        return Common::join(socketFd, ip, ifaceIp);
     }
 
     auto McastSocket::leave(const std::string &, int) -> void {
         close(socketFd);    
         socketFd = -1;
+        if (packet_ring)
+            logger.log("%:% %() % packet ring dropped:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&timeStr), packet_ring->dropped());
+        delete packet_ring;
+        packet_ring = nullptr;
     }
 
     auto McastSocket::sendAndRecv() noexcept -> bool {
-        // recv data 
-        const ssize_t nRecv = recv(socketFd, recv_buffer.data() + next_recv_valid_index, McastSocketBufferSize - next_recv_valid_index, MSG_DONTWAIT);
+        return sendAndRecv(recv_callback);
+    }
+
+    auto McastSocket::recvDatagrams() noexcept -> size_t {
+        // the kernel overwrites the lengths of the last call
+        for (size_t i = 0; i < McastRecvBatch; i++) {
+            recv_iovs[i] = {recv_buffer.data() + i * McastMaxDatagramSize, McastMaxDatagramSize};
+            auto& hdr = recv_msgs[i].msg_hdr;
+            hdr.msg_iov = &recv_iovs[i];
+            hdr.msg_iovlen = 1;
+            hdr.msg_control = recv_ctrls[i].data();
+            hdr.msg_controllen = recv_ctrls[i].size();
+        }
+
+        const int n = recvmmsg(socketFd, recv_msgs.data(), McastRecvBatch, MSG_DONTWAIT, nullptr);
+        if (n <= 0)
+            return 0;
+
+        for (int i = 0; i < n; i++) {
+            recv_times[i] = getRxTimestamp(&recv_msgs[i].msg_hdr);
+            if (UNLIKELY(recv_msgs[i].msg_hdr.msg_flags & MSG_TRUNC))
+                logger.log("%:% %() % WARN datagram truncated socket:% max:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&timeStr), socketFd, McastMaxDatagramSize);
+        }
+
+        logger.log("%:% %() % read socket:% datagrams:% ktime:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&timeStr), socketFd, n, recv_times[0]);
+        return static_cast<size_t>(n);
+    }
+
+    auto McastSocket::publish() noexcept -> void {
+        if (next_send_valid_index == 0)
+            return;
 
-        if (nRecv > 0) {
-            next_recv_valid_index += nRecv;
-            logger.log("%:% %() % read socket:% len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&timeStr), socketFd, next_recv_valid_index);
-            recv_callback(this);
+        endDatagram();
+        size_t start = 0, sent = 0;
+        while (sent < send_datagram_ends.size()) {
+            const auto count = std::min(McastSendBatch, send_datagram_ends.size() - sent);
+            for (size_t i = 0; i < count; i++) {
+                const auto end = send_datagram_ends[sent + i];
+                send_iovs[i] = {send_buffer.data() + start, end - start};
+                send_msgs[i].msg_hdr.msg_iov = &send_iovs[i];
+                send_msgs[i].msg_hdr.msg_iovlen = 1;
+                start = end;
+            }
+
+            const int n = sendmmsg(socketFd, send_msgs.data(), count, MSG_DONTWAIT | MSG_NOSIGNAL);
+            logger.log("%:% %() % send socket:% datagrams:% of:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&timeStr), socketFd, n, count);
+            if (n <= 0)
+                break;
+            sent += n;
+            if (static_cast<size_t>(n) < count)
+                break;
         }
 
-        // send data
-        if (next_send_valid_index > 0) {
-            const ssize_t n = ::send(socketFd, send_buffer.data(), next_send_valid_index, MSG_DONTWAIT | MSG_NOSIGNAL);
-            logger.log("%:% %() % send socket:% len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&timeStr), socketFd, n); 
+        // datagrams the kernel had no room for stay queued, in order, for the next call
+        if (UNLIKELY(sent < send_datagram_ends.size())) {
+            const auto sentBytes = sent ? send_datagram_ends[sent - 1] : 0;
+            memmove(send_buffer.data(), send_buffer.data() + sentBytes, next_send_valid_index - sentBytes);
+            send_datagram_ends.erase(send_datagram_ends.begin(), send_datagram_ends.begin() + sent);
+            for (auto& end : send_datagram_ends)
+                end -= sentBytes;
+            next_send_valid_index -= sentBytes;
+            return;
         }
 
         next_send_valid_index = 0;
-        next_recv_valid_index = 0;
-        return (nRecv > 0);
+        send_datagram_ends.clear();
     }
 
     auto McastSocket::send(const void *data, size_t len) noexcept -> void {
+        if (UNLIKELY(next_send_valid_index + len > send_buffer.size())) {
+            ASSERT(next_send_valid_index + len <= max_send_size, "Mcast socket buffer filled up and sendAndRecv() not called.");
+            send_buffer.resize(std::min(std::max(2 * send_buffer.size(), next_send_valid_index + len), max_send_size));
+            logger.log("%:% %() % send buffer of socket:% grew to:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&timeStr), socketFd, send_buffer.size());
+        }
+
         memcpy(send_buffer.data() + next_send_valid_index, data, len);
         next_send_valid_index += len;
-        ASSERT(next_send_valid_index < McastSocketBufferSize, "Mcast socket buffer filled up and sendAndRecv() not called.");
+        send_high_water = std::max(send_high_water, next_send_valid_index);
     }
 
 }
\ No newline at end of file
@@ -1,19 +1,53 @@
 #pragma once
 
+#include <array>
 #include <functional>
 #include "logging.h"
+#include "packet_ring.h"
 #include "socket_utils.h"
 
 namespace Common {
-    // max size of send and recv buffers of mcast_socket
-    constexpr size_t McastSocketBufferSize = 64 * 1024 * 1024;
+    // size the send buffer starts at and the most it doubles to when more updates are queued between two sendAndRecv() calls
+    constexpr SocketBufferCfg McastBufferCfg{64 * 1024, 64 * 1024 * 1024};
+    // datagrams read with one recvmmsg() and sent with one sendmmsg()
+    constexpr size_t McastRecvBatch = 64;
+    constexpr size_t McastSendBatch = 256;
+    // largest datagram a receiving socket takes, fits a jumbo frame, anything bigger is truncated
+    constexpr size_t McastMaxDatagramSize = 9 * 1024;
+
+    enum class McastBackend : uint8_t {
+        SOCKET = 0, // recvmmsg() on the udp socket
+        PACKET_RING = 1 // TPACKET_V3 ring of the interface mapped into user space, the udp socket only holds the memberships
+    };
+
+    inline auto mcastBackendToString(McastBackend backend) -> std::string {
+        switch (backend) {
+            case McastBackend::SOCKET:
+                return "SOCKET";
+            case McastBackend::PACKET_RING:
+                return "PACKET_RING";
+        }
+        return "UNKNOWN";
+    }
 
     struct McastSocket {
-        McastSocket(Logger &logger): logger(logger) {
-            send_buffer.resize(McastSocketBufferSize);
-            recv_buffer.resize(McastSocketBufferSize);
+        explicit McastSocket(Logger &logger, const SocketBufferCfg& buffers = McastBufferCfg): max_send_size(buffers.max_size), logger(logger) {
+            send_buffer.resize(buffers.initial_size);
+            send_datagram_ends.reserve(McastSendBatch);
         }
 
+        ~McastSocket() {
+            delete packet_ring;
+            if (socketFd >= 0)
+                close(socketFd);
+        }
+
+        McastSocket() = delete;
+        McastSocket(const McastSocket&) = delete;
+        McastSocket(const McastSocket&&) = delete;
+        McastSocket& operator=(const McastSocket&) = delete;
+        McastSocket& operator=(const McastSocket&&) = delete;
+
         // initializes multicast socket to send or recv from stream
         // Does not join the multicast stream yet
         auto init(const std::string &ip, const std::string &iface,const int port, bool is_listening) noexcept -> int;
@@ -27,16 +61,91 @@ namespace Common {
         // publishes data and reads incoming data
         auto sendAndRecv() noexcept -> bool;
 
+        // as above, with on_recv(socket, rx_time) called for the datagrams read instead of recv_callback
+        // the handler's type is known at compile time, so its parsing can be inlined into the read
+        // a burst of up to McastRecvBatch datagrams is read with one recvmmsg(), on_recv is called once per datagram
+        template<typename OnRecv>
+        auto sendAndRecv(OnRecv&& on_recv) noexcept -> bool {
+            size_t received = 0;
+            if (packet_ring) {
+                // datagrams are handed on straight out of the ring, nothing is copied
+                received = packet_ring->poll([&](const char* data, size_t len, Nanos rx_time) {
+                    recv_data = data;
+                    next_recv_valid_index = len;
+                    on_recv(this, rx_time);
+                });
+            } else {
+                received = recvDatagrams();
+                for (size_t i = 0; i < received; i++) {
+                    recv_data = recv_buffer.data() + i * McastMaxDatagramSize;
+                    next_recv_valid_index = recv_msgs[i].msg_len;
+                    on_recv(this, recv_times[i]);
+                }
+            }
+
+            publish();
+            next_recv_valid_index = 0;
+            return (received > 0);
+        }
+
         // copies data to send buffer does not publish message
         auto send(const void *data, size_t len) noexcept -> void;
 
+        // ends the datagram the bytes sent since the last call go out in, receivers get it in one piece
+        // bytes that are not closed off by the next sendAndRecv() go out in one datagram
+        auto endDatagram() noexcept -> void {
+            if (next_send_valid_index > (send_datagram_ends.empty() ? 0 : send_datagram_ends.back()))
+                send_datagram_ends.push_back(next_send_valid_index);
+        }
+
+        // datagram handed to on_recv, next_recv_valid_index bytes long
+        auto recvData() const noexcept -> const char* {
+            return recv_data;
+        }
+
+        // bytes of memory the send & receive buffers take up
+        auto bufferMemory() const noexcept -> size_t {
+            return send_buffer.size() + recv_buffer.size();
+        }
+
+    private:
+        // reads up to McastRecvBatch datagrams into recv_buffer, returns the number read
+        auto recvDatagrams() noexcept -> size_t;
+        // sends the datagrams queued by send() & endDatagram()
+        auto publish() noexcept -> void;
+
+    public:
         int socketFd = -1;
+        // address of the interface passed to init(), groups are joined on it
+        std::string ifaceIp;
         std::vector<char> send_buffer;
-        size_t next_send_valid_index;
-        std::vector<char> recv_buffer;
-        size_t next_recv_valid_index;
+        size_t next_send_valid_index = 0;
+        // most bytes queued between two sendAndRecv() calls, send_buffer grows up to max_send_size
+        size_t send_high_water = 0;
+        const size_t max_send_size;
+        // offsets into send_buffer where queued datagrams end
+        std::vector<size_t> send_datagram_ends;
+        std::array<mmsghdr, McastSendBatch> send_msgs = {};
+        std::array<iovec, McastSendBatch> send_iovs = {};
+
+        // McastRecvBatch slots of McastMaxDatagramSize bytes, one per datagram of a recvmmsg()
+        std::vector<char> recv_buffer = std::vector<char>(McastRecvBatch * McastMaxDatagramSize);
+        std::array<mmsghdr, McastRecvBatch> recv_msgs = {};
+        std::array<iovec, McastRecvBatch> recv_iovs = {};
+        std::array<std::array<char, RX_TIMESTAMP_CONTROL_SIZE>, McastRecvBatch> recv_ctrls = {};
+        std::array<Nanos, McastRecvBatch> recv_times = {};
+        // the datagram being handed to on_recv
+        const char* recv_data = nullptr;
+        size_t next_recv_valid_index = 0;
 
-        std::function<void(McastSocket*)> recv_callback = nullptr;
+        // called with the kernel receive time of the last datagram read
+        std::function<void(McastSocket*, Nanos rx_time)> recv_callback = nullptr;
+        // set before init()
+        SocketBusyPollCfg busy_poll;
+        // set before init(), how a listening socket reads, sending always goes through the udp socket
+        McastBackend backend = McastBackend::SOCKET;
+        // only used by the PACKET_RING backend
+        PacketRing* packet_ring = nullptr;
         Logger& logger;        
         std::string timeStr;
     };
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "macros.h"
+
+namespace Common {
+    // byte ring buffer whose memory is mapped twice back to back, so the unread bytes (and the free space)
+    // are always one contiguous region no matter where they wrap around
+    class MirroredBuffer final {
+    public:
+        // starts out with size bytes and can grow up to max_size, 0 keeps it at its initial size
+        explicit MirroredBuffer(size_t size, size_t max_size = 0) {
+            _pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            _capacity = roundToPages(size);
+            _maxCapacity = std::max(_capacity, roundToPages(max_size));
+            _data = map(_capacity);
+        }
+
+        ~MirroredBuffer() {
+            releaseOld();
+            munmap(_data, 2 * _capacity);
+            _data = nullptr;
+        }
+
+        MirroredBuffer() = delete;
+        MirroredBuffer(const MirroredBuffer&) = delete;
+        MirroredBuffer(const MirroredBuffer&&) = delete;
+        MirroredBuffer& operator=(const MirroredBuffer&) = delete;
+        MirroredBuffer& operator=(const MirroredBuffer&&) = delete;
+
+        // start of the unread bytes
+        auto readPtr() const noexcept -> const char* {
+            return _data + _readIndex;
+        }
+
+        // number of unread bytes
+        auto size() const noexcept -> size_t {
+            return _writeIndex - _readIndex;
+        }
+
+        // start of the free space
+        auto writePtr() noexcept -> char* {
+            return _data + _writeIndex;
+        }
+
+        // number of bytes that can be written at writePtr()
+        auto freeSpace() const noexcept -> size_t {
+            return _capacity - size();
+        }
+
+        auto capacity() const noexcept -> size_t {
+            return _capacity;
+        }
+
+        auto maxCapacity() const noexcept -> size_t {
+            return _maxCapacity;
+        }
+
+        // most bytes that were unread at once
+        auto highWater() const noexcept -> size_t {
+            return _highWater;
+        }
+
+        // number of times the buffer had to grow
+        auto numGrows() const noexcept -> size_t {
+            return _numGrows;
+        }
+
+        // makes room for len more bytes, moving the unread bytes into a mapping at least twice as big when needed
+        // returns false if that would take more than the max size, pointers into the buffer are invalid after it grew
+        // unless keep_old is set, then the mapping they point into stays around until releaseOld()
+        auto reserve(size_t len, bool keep_old = false) noexcept -> bool {
+            if (LIKELY(len <= freeSpace()))
+                return true;
+
+            auto capacity = _capacity;
+            while (capacity - size() < len && capacity < _maxCapacity)
+                capacity = std::min(2 * capacity, _maxCapacity);
+            if (capacity - size() < len)
+                return false;
+
+            auto data = map(capacity);
+            memcpy(data, readPtr(), size());
+            // only the first mapping given up since the last releaseOld() can still be referenced
+            if (keep_old && !_old) {
+                _old = _data;
+                _oldCapacity = _capacity;
+            } else {
+                munmap(_data, 2 * _capacity);
+            }
+
+            _writeIndex = size();
+            _readIndex = 0;
+            _data = data;
+            _capacity = capacity;
+            _numGrows++;
+            return true;
+        }
+
+        // marks len bytes written at writePtr() as readable
+        auto commitWrite(size_t len) noexcept -> void {
+            if (UNLIKELY(len > freeSpace()))
+                FATAL("MirroredBuffer overflow, wrote:" + std::to_string(len) + " free:" + std::to_string(freeSpace()));
+            _writeIndex += len;
+            _highWater = std::max(_highWater, size());
+        }
+
+        // consumes len bytes starting at readPtr()
+        auto commitRead(size_t len) noexcept -> void {
+            _readIndex += len;
+            // keep both cursors inside the first copy, the mirror makes this a free wrap around
+            if (_readIndex >= _capacity) {
+                _readIndex -= _capacity;
+                _writeIndex -= _capacity;
+            }
+        }
+
+        // unmaps the mapping a reserve() with keep_old moved away from
+        auto releaseOld() noexcept -> void {
+            if (_old)
+                munmap(_old, 2 * _oldCapacity);
+            _old = nullptr;
+            _oldCapacity = 0;
+        }
+
+        // drops everything unread
+        auto clear() noexcept -> void {
+            _readIndex = _writeIndex = 0;
+        }
+
+    private:
+        auto roundToPages(size_t size) const noexcept -> size_t {
+            return std::max(_pageSize, ((size + _pageSize - 1) / _pageSize) * _pageSize);
+        }
+
+        // maps capacity bytes of a new memfd twice back to back, pages are only backed once they are touched
+        static auto map(size_t capacity) noexcept -> char* {
+            const int fd = memfd_create("mirrored_buffer", 0);
+            ASSERT(fd != -1, "memfd_create() failed, error: " + std::string(strerror(errno)));
+            ASSERT(ftruncate(fd, capacity) == 0, "ftruncate() failed, error: " + std::string(strerror(errno)));
+
+            // reserve address space for both copies, then map the same pages into each half
+            auto base = static_cast<char*>(mmap(nullptr, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+            ASSERT(base != MAP_FAILED, "mmap() reserve failed, error: " + std::string(strerror(errno)));
+            ASSERT(mmap(base, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == base, "mmap() first half failed, error: " + std::string(strerror(errno)));
+            ASSERT(mmap(base + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == base + capacity, "mmap() second half failed, error: " + std::string(strerror(errno)));
+            close(fd);
+
+            return base;
+        }
+
+        char* _data = nullptr;
+        size_t _pageSize = 0;
+        size_t _capacity = 0;
+        size_t _maxCapacity = 0;
+        size_t _highWater = 0;
+        size_t _numGrows = 0;
+        char* _old = nullptr;
+        size_t _oldCapacity = 0;
+        size_t _readIndex = 0;
+        size_t _writeIndex = 0;
+    };
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "macros.h"
+#include "types.h"
+
+namespace Common {
+    // open addressing index of the live orders of a book by market order id, sized to the orders the book can hold so
+    // it never has to grow: order ids only go up, so a table indexed by them would run out long before the live orders
+    // do, at most half its slots are taken, lookups probe linearly from the hash of the id and removal shifts the rest
+    // of a run back instead of leaving tombstones
+    template<typename T>
+    class OrderIdIndex final {
+    public:
+        explicit OrderIdIndex(size_t maxOrders) {
+            size_t bits = 4;
+            while ((size_t{1} << bits) < maxOrders * 2)
+                bits++;
+            _slots.resize(size_t{1} << bits);
+            _mask = _slots.size() - 1;
+            _shift = 64 - bits;
+        }
+
+        OrderIdIndex() = delete;
+        OrderIdIndex(const OrderIdIndex&) = delete;
+        OrderIdIndex(const OrderIdIndex&&) = delete;
+        OrderIdIndex& operator=(const OrderIdIndex&) = delete;
+        OrderIdIndex& operator=(const OrderIdIndex&&) = delete;
+
+        // function for finding the live order with orderId, nullptr if there is none
+        auto find(OrderId orderId) const noexcept -> T* {
+            for (auto i = home(orderId);; i = (i + 1) & _mask) {
+                const auto& slot = _slots[i];
+                if (!slot.order || slot.orderId == orderId)
+                    return slot.order;
+            }
+        }
+
+        // method for indexing order under orderId, an order with the same id is replaced
+        auto insert(OrderId orderId, T* order) noexcept -> void {
+            auto i = home(orderId);
+            while (_slots[i].order && _slots[i].orderId != orderId)
+                i = (i + 1) & _mask;
+
+            _size += !_slots[i].order;
+            if (UNLIKELY(_size * 2 > _slots.size()))
+                FATAL("OrderIdIndex over capacity:" + std::to_string(_slots.size()));
+            _slots[i] = {orderId, order};
+        }
+
+        // method for removing the order with orderId
+        auto erase(OrderId orderId) noexcept -> void {
+            auto i = home(orderId);
+            while (_slots[i].order && _slots[i].orderId != orderId)
+                i = (i + 1) & _mask;
+            if (!_slots[i].order)
+                return;
+
+            // move later entries of the run into the hole unless that would put them before their home slot
+            for (auto j = (i + 1) & _mask; _slots[j].order; j = (j + 1) & _mask) {
+                const auto h = home(_slots[j].orderId);
+                if (((j - h) & _mask) >= ((j - i) & _mask)) {
+                    _slots[i] = _slots[j];
+                    i = j;
+                }
+            }
+            _slots[i] = {};
+            _size--;
+        }
+
+        // method for calling f(order) for every live order, in no particular order
+        template<typename F>
+        auto forEach(F&& f) const noexcept -> void {
+            for (const auto& slot : _slots) {
+                if (slot.order)
+                    f(slot.order);
+            }
+        }
+
+        auto clear() noexcept -> void {
+            std::fill(_slots.begin(), _slots.end(), Slot{});
+            _size = 0;
+        }
+
+        auto size() const noexcept -> size_t {
+            return _size;
+        }
+
+        auto memory() const noexcept -> size_t {
+            return _slots.size() * sizeof(Slot);
+        }
+
+    private:
+        struct Slot {
+            OrderId orderId = OrderId_INVALID;
+            T* order = nullptr;
+        };
+
+        // slot the probe for an id starts at (fibonacci hashing of the id)
+        auto home(OrderId orderId) const noexcept -> size_t {
+            return static_cast<size_t>((static_cast<uint64_t>(orderId) * 0x9E3779B97F4A7C15ull) >> _shift);
+        }
+
+        std::vector<Slot> _slots;
+        size_t _mask = 0;
+        unsigned _shift = 0;
+        size_t _size = 0;
+    };
+}
@@ -0,0 +1,64 @@
+#include "packet_ring.h"
+
+#include <cstring>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <linux/if_ether.h>
+
+namespace Common {
+    PacketRing::PacketRing(Logger& logger, const std::string& iface, int port) : port(htons(static_cast<uint16_t>(port))), logger(logger) {
+        fd = socket(AF_PACKET, SOCK_DGRAM, htons(ETH_P_IP));
+        ASSERT(fd >= 0, "socket(AF_PACKET) failed, error: " + std::string(strerror(errno)));
+
+        int version = TPACKET_V3;
+        ASSERT(setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) == 0, "setsockopt(PACKET_VERSION) failed, error: " + std::string(strerror(errno)));
+        // copies of what we send ourselves are of no use
+        int ignore_outgoing = 1;
+        setsockopt(fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &ignore_outgoing, sizeof(ignore_outgoing));
+
+        tpacket_req3 req = {};
+        req.tp_block_size = PacketRingBlockSize;
+        req.tp_block_nr = PacketRingBlocks;
+        req.tp_frame_size = PacketRingFrameSize;
+        req.tp_frame_nr = PacketRingBlockSize / PacketRingFrameSize * PacketRingBlocks;
+        req.tp_retire_blk_tov = PacketRingBlockTimeoutMs;
+        ASSERT(setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) == 0, "setsockopt(PACKET_RX_RING) failed, error: " + std::string(strerror(errno)));
+
+        ring_size = static_cast<size_t>(PacketRingBlockSize) * PacketRingBlocks;
+        void* mem = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+        ASSERT(mem != MAP_FAILED, "mmap() of packet ring failed, error: " + std::string(strerror(errno)));
+        ring = static_cast<char*>(mem);
+
+        // only frames of the interface the feed comes in on
+        sockaddr_ll addr = {};
+        addr.sll_family = AF_PACKET;
+        addr.sll_protocol = htons(ETH_P_IP);
+        addr.sll_ifindex = static_cast<int>(if_nametoindex(iface.c_str()));
+        ASSERT(addr.sll_ifindex > 0, "if_nametoindex() failed for iface:" + iface + " error: " + std::string(strerror(errno)));
+        ASSERT(bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0, "bind() of packet socket failed, error: " + std::string(strerror(errno)));
+
+        logger.log("%:% %() % packet ring fd:% iface:% port:% blocks:% block_size:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str),
+                    fd, iface, port, PacketRingBlocks, PacketRingBlockSize);
+    }
+
+    PacketRing::~PacketRing() {
+        if (ring)
+            munmap(ring, ring_size);
+        if (fd >= 0)
+            close(fd);
+    }
+
+    auto PacketRing::addGroup(const std::string& ip) noexcept -> void {
+        groups.push_back(inet_addr(ip.c_str()));
+    }
+
+    auto PacketRing::dropped() noexcept -> size_t {
+        // reading the statistics resets them
+        tpacket_stats_v3 stats = {};
+        socklen_t len = sizeof(stats);
+        if (getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) != 0)
+            return 0;
+        return stats.tp_drops;
+    }
+}
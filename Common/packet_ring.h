@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vector>
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include "logging.h"
+#include "macros.h"
+#include "time_utils.h"
+
+namespace Common {
+    // the ring is split into blocks the kernel fills with frames and hands over as a whole, a block that is not
+    // full is handed over once PacketRingBlockTimeoutMs passed, which bounds the latency a quiet feed adds
+    constexpr unsigned PacketRingBlockSize = 1 << 20;
+    constexpr unsigned PacketRingBlocks = 16;
+    constexpr unsigned PacketRingFrameSize = 2048;
+    constexpr unsigned PacketRingBlockTimeoutMs = 1;
+
+    // receives the udp datagrams of an interface through an AF_PACKET TPACKET_V3 ring mapped into user space
+    // instead of a recvmmsg() per burst, ip & udp headers are parsed here and only datagrams sent to one of the
+    // joined groups on port are handed on, the kernel still has to be told about the groups (IGMP) through a socket
+    struct PacketRing {
+        PacketRing(Logger& logger, const std::string& iface, int port);
+        ~PacketRing();
+
+        PacketRing() = delete;
+        PacketRing(const PacketRing&) = delete;
+        PacketRing(const PacketRing&&) = delete;
+        PacketRing& operator=(const PacketRing&) = delete;
+        PacketRing& operator=(const PacketRing&&) = delete;
+
+        // method for handing on datagrams sent to group ip
+        auto addGroup(const std::string& ip) noexcept -> void;
+
+        // method for calling on_datagram(data, len, rx_time) for every matching datagram of the blocks the kernel
+        // handed over, blocks go back to the kernel once read, returns the number of datagrams handed on
+        template<typename OnDatagram>
+        auto poll(OnDatagram&& on_datagram) noexcept -> size_t;
+
+        // method for reading the frames the kernel dropped because the ring was full since the last call
+        auto dropped() noexcept -> size_t;
+
+    private:
+        // finds the udp payload of a frame, returns false if it is not a datagram for us
+        auto payload(const tpacket3_hdr* frame, const char** data, size_t* len) const noexcept -> bool;
+
+    public:
+        int fd = -1;
+        char* ring = nullptr;
+        size_t ring_size = 0;
+        // block the kernel hands over next
+        unsigned block = 0;
+        // udp port & groups in network byte order
+        uint16_t port;
+        std::vector<in_addr_t> groups;
+        std::string time_str;
+        Logger& logger;
+    };
+
+    inline auto PacketRing::payload(const tpacket3_hdr* frame, const char** data, size_t* len) const noexcept -> bool {
+        // the socket is SOCK_DGRAM, frames start at the ip header whatever the link layer
+        const auto ll = reinterpret_cast<const sockaddr_ll*>(reinterpret_cast<const char*>(frame) + TPACKET_ALIGN(sizeof(tpacket3_hdr)));
+        if (UNLIKELY(ll->sll_pkttype == PACKET_OUTGOING))
+            return false;
+
+        const auto ip = reinterpret_cast<const iphdr*>(reinterpret_cast<const char*>(frame) + frame->tp_net);
+        if (frame->tp_snaplen < sizeof(iphdr) || ip->version != 4 || ip->protocol != IPPROTO_UDP)
+            return false;
+        // fragments would have to be put back together, market data datagrams fit a packet
+        if (UNLIKELY(ntohs(ip->frag_off) & (IP_MF | IP_OFFMASK)))
+            return false;
+
+        bool joined = false;
+        for (const auto group : groups)
+            joined |= (group == ip->daddr);
+        if (!joined)
+            return false;
+
+        const size_t ip_len = ip->ihl * 4;
+        const auto udp = reinterpret_cast<const udphdr*>(reinterpret_cast<const char*>(ip) + ip_len);
+        if (frame->tp_snaplen < ip_len + sizeof(udphdr) || udp->dest != port)
+            return false;
+
+        const size_t udp_len = ntohs(udp->len);
+        if (UNLIKELY(udp_len < sizeof(udphdr) || ip_len + udp_len > frame->tp_snaplen))
+            return false;
+
+        *data = reinterpret_cast<const char*>(udp + 1);
+        *len = udp_len - sizeof(udphdr);
+        return true;
+    }
+
+    template<typename OnDatagram>
+    auto PacketRing::poll(OnDatagram&& on_datagram) noexcept -> size_t {
+        size_t handed_on = 0;
+        while (true) {
+            auto desc = reinterpret_cast<tpacket_block_desc*>(ring + static_cast<size_t>(block) * PacketRingBlockSize);
+            if (!(__atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+                break;
+
+            auto frame = reinterpret_cast<const tpacket3_hdr*>(reinterpret_cast<char*>(desc) + desc->hdr.bh1.offset_to_first_pkt);
+            for (uint32_t i = 0; i < desc->hdr.bh1.num_pkts; i++) {
+                const char* data;
+                size_t len;
+                if (payload(frame, &data, &len)) {
+                    on_datagram(data, len, static_cast<Nanos>(frame->tp_sec) * NANOS_TO_SEC + frame->tp_nsec);
+                    handed_on++;
+                }
+                frame = reinterpret_cast<const tpacket3_hdr*>(reinterpret_cast<const char*>(frame) + frame->tp_next_offset);
+            }
+
+            __atomic_store_n(&desc->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+            block = (block + 1) % PacketRingBlocks;
+        }
+
+        return handed_on;
+    }
+}
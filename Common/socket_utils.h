@@ -15,11 +15,47 @@
 #include <ifaddrs.h>
 #include <sys/socket.h>
 #include <fcntl.h>
+#include <ctime>
+#include <sys/ioctl.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <linux/filter.h>
 #include "macros.h"
 #include "logging.h"
+#include "time_utils.h"
+
+#ifndef EPIOCSPARAMS
+// epoll busy poll parameters (linux 6.9), not in older uapi headers
+struct epoll_params {
+    uint32_t busy_poll_usecs;
+    uint16_t busy_poll_budget;
+    uint8_t prefer_busy_poll;
+    uint8_t __pad;
+};
+#define EPIOCSPARAMS _IOW(0x8A, 0x01, struct epoll_params)
+#endif
 
 namespace Common {
     constexpr int MAX_TCP_SERVER_BACK_LOG = 1024;
+    // control buffer size that fits any of the receive timestamp messages
+    constexpr size_t RX_TIMESTAMP_CONTROL_SIZE = CMSG_SPACE(sizeof(scm_timestamping));
+
+    // lets reads spin on the device queue instead of waiting for interrupts, all zero leaves busy polling off
+    struct SocketBusyPollCfg {
+        int busy_poll_us = 0; // SO_BUSY_POLL, how long a read spins on the device queue when there is no data
+        int busy_poll_budget = 0; // SO_BUSY_POLL_BUDGET, packets processed per busy poll, 0 for the kernel default
+        bool prefer_busy_poll = false; // SO_PREFER_BUSY_POLL, hold off softirq processing while the app busy polls
+
+        auto enabled() const noexcept -> bool {
+            return (busy_poll_us > 0 || prefer_busy_poll);
+        }
+    };
+
+    // size a socket's send and receive buffers start at and the most they may grow to when data piles up
+    struct SocketBufferCfg {
+        size_t initial_size = 0;
+        size_t max_size = 0;
+    };
     
     inline auto getIfaceIP(const std::string& iface) noexcept -> std::string {
         char buff[NI_MAXHOST] = {'\0'};
@@ -55,6 +91,11 @@ namespace Common {
         return (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<void *>(&one), sizeof(one)) != -1);
     }
 
+    inline auto setZeroCopy(int fd) noexcept -> bool {
+        int one = 1;
+        return (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, reinterpret_cast<void *>(&one), sizeof(one)) != -1);
+    }
+
     inline auto wouldBlock() noexcept -> bool {
         return (errno == EWOULDBLOCK || errno == EINPROGRESS);
     }
@@ -67,22 +108,83 @@ namespace Common {
         return (setsockopt(fd, IPPROTO_TCP, IP_MULTICAST_TTL, reinterpret_cast<void *>(&mcast_ttl), sizeof(mcast_ttl)) != -1);
     }
 
-    inline auto join(int fd, const std::string& ip) -> bool {
-        const ip_mreq mreq{{inet_addr(ip.c_str())}, {htonl(INADDR_ANY)}};
+    // sends multicast out of the interface with address iface_ip instead of the one the routing table picks
+    inline auto setMcastInterface(int fd, const std::string& iface_ip) noexcept -> bool {
+        const in_addr addr{inet_addr(iface_ip.c_str())};
+        return (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &addr, sizeof(addr)) != -1);
+    }
+
+    // joins group ip on the interface with address iface_ip, or on the one the routing table picks when empty
+    inline auto join(int fd, const std::string& ip, const std::string& iface_ip = "") -> bool {
+        const ip_mreq mreq{{inet_addr(ip.c_str())}, {iface_ip.empty() ? htonl(INADDR_ANY) : inet_addr(iface_ip.c_str())}};
         return (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != -1);
     }
 
+    // drops every datagram the socket would queue, for sockets that are only kept to hold group memberships
+    inline auto setDropAll(int fd) noexcept -> bool {
+        sock_filter drop = BPF_STMT(BPF_RET | BPF_K, 0);
+        const sock_fprog prog{1, &drop};
+        return (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) != -1);
+    }
+
+    // nanosecond software receive timestamps, SO_TIMESTAMPING where available and SO_TIMESTAMPNS otherwise
     inline auto setSOTimestamp(int fd) noexcept -> bool {
+        int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, reinterpret_cast<void*>(&flags), sizeof(flags)) != -1)
+            return true;
+
         int one = 1;
-        return (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMP, reinterpret_cast<void*>(&one), sizeof(one)) != 1);
+        return (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, reinterpret_cast<void*>(&one), sizeof(one)) != -1);
     }
 
-    [[nodiscard]] inline auto createSocket(Logger &logger, const std::string& t_ip, const std::string& iface, int port, bool is_udp, bool is_blocking, bool is_listening, int ttl, bool needs_so_timestamp) noexcept -> int {
+    // kernel receive time in the control messages of a recvmsg(), 0 if the socket has no timestamps enabled
+    inline auto getRxTimestamp(msghdr* msg) noexcept -> Nanos {
+        for (auto cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET)
+                continue;
+
+            if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+                scm_timestamping tss;
+                memcpy(&tss, CMSG_DATA(cmsg), sizeof(tss));
+                return tss.ts[0].tv_sec * NANOS_TO_SEC + tss.ts[0].tv_nsec; // ts[0] is the software timestamp
+            }
+            if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                return ts.tv_sec * NANOS_TO_SEC + ts.tv_nsec;
+            }
+            if (cmsg->cmsg_type == SCM_TIMESTAMP) {
+                timeval tv;
+                memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+                return tv.tv_sec * NANOS_TO_SEC + tv.tv_usec * NANOS_TO_MICROS;
+            }
+        }
+
+        return 0;
+    }
+
+    inline auto setBusyPoll(int fd, const SocketBusyPollCfg& cfg) noexcept -> bool {
+        int prefer = cfg.prefer_busy_poll;
+        return (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, reinterpret_cast<const void*>(&cfg.busy_poll_us), sizeof(cfg.busy_poll_us)) != -1 &&
+                setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, reinterpret_cast<void*>(&prefer), sizeof(prefer)) != -1 &&
+                (!cfg.busy_poll_budget || setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL_BUDGET, reinterpret_cast<const void*>(&cfg.busy_poll_budget), sizeof(cfg.busy_poll_budget)) != -1));
+    }
+
+    // busy polls the device queues of the sockets in an epoll instance from epoll_wait(), needs linux 6.9
+    inline auto setEpollBusyPoll(int efd, const SocketBusyPollCfg& cfg) noexcept -> bool {
+        epoll_params params = {};
+        params.busy_poll_usecs = static_cast<uint32_t>(cfg.busy_poll_us);
+        params.busy_poll_budget = static_cast<uint16_t>(cfg.busy_poll_budget);
+        params.prefer_busy_poll = cfg.prefer_busy_poll;
+        return (ioctl(efd, EPIOCSPARAMS, &params) != -1);
+    }
+
+    [[nodiscard]] inline auto createSocket(Logger &logger, const std::string& t_ip, const std::string& iface, int port, bool is_udp, bool is_blocking, bool is_listening, int ttl, bool needs_so_timestamp, const SocketBusyPollCfg& busy_poll = {}) noexcept -> int {
         std::string time_str;
 
         const auto ip = t_ip.empty()? getIfaceIP(iface) : t_ip;
 
-        logger.log("%:% %() % ip:% iface:% port:% is_udp:% is_blocking:% is_listening:% ttl:% SO_time:%\n",__FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str), ip, iface, port, is_udp, is_blocking, is_listening, ttl, needs_so_timestamp);
+        logger.log("%:% %() % ip:% iface:% port:% is_udp:% is_blocking:% is_listening:% ttl:% SO_time:% busy_poll:%us\n",__FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str), ip, iface, port, is_udp, is_blocking, is_listening, ttl, needs_so_timestamp, busy_poll.busy_poll_us);
 
         const int input_flags = (is_listening ? AI_PASSIVE : 0) | (AI_NUMERICHOST | AI_NUMERICSERV);
         const addrinfo hints{input_flags, AF_INET, is_udp ? SOCK_DGRAM : SOCK_STREAM,
@@ -103,16 +205,24 @@ namespace Common {
             ASSERT(setNonBlocking(fd), "setNonBlocking() failed, error: " + std::string(strerror(errno)));
 
             if (!is_udp) // disable nagle for tcp sockets
-                ASSERT(setNonBlocking(fd), "setNonBlocking() failed, error: " + std::string(strerror(errno)));
+                ASSERT(setNoDelay(fd), "setNoDelay() failed, error: " + std::string(strerror(errno)));
 
-            if (!is_listening) // connect to remote addr
-                ASSERT(connect(fd, rp->ai_addr, rp->ai_addrlen) != -1, "connect() failed, error: " + std::string(strerror(errno)));
+            if (is_udp && !is_listening) { // publish on the requested interface, receivers join the group on it
+                const auto iface_ip = getIfaceIP(iface);
+                if (!iface_ip.empty())
+                    ASSERT(setMcastInterface(fd, iface_ip), "setMcastInterface() failed, error: " + std::string(strerror(errno)));
+            }
+
+            if (!is_listening) { // connect to remote addr, non blocking tcp sockets complete the connection in the background
+                const auto rc = connect(fd, rp->ai_addr, rp->ai_addrlen);
+                ASSERT(rc != -1 || wouldBlock(), "connect() failed, error: " + std::string(strerror(errno)));
+            }
         
             if (is_listening) // allow reuse of addr in call to bind
                 ASSERT(setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&one), sizeof(one)) == 0, "setsockopt() SO_REUSEADDR failed. errno:" + std::string(strerror(errno)));
 
             if (is_listening) { // bind to specific port
-                const sockaddr_in addr{AF_INET, port, {htonl(INADDR_ANY)}, {}};
+                const sockaddr_in addr{AF_INET, htons(static_cast<in_port_t>(port)), {htonl(INADDR_ANY)}, {}};
                 ASSERT(bind(fd, is_udp? reinterpret_cast<const struct sockaddr *>(&addr) : rp->ai_addr, sizeof(addr)) == 0, "bind() failed. errno:%" + std::string(strerror(errno)));
             }
 
@@ -121,6 +231,9 @@ namespace Common {
         
             if (needs_so_timestamp) // enamble software timestamps
                 ASSERT(setSOTimestamp(fd), "setSOTimestamp() failed, error: " + std::string(strerror(errno)));
+
+            if (busy_poll.enabled())
+                ASSERT(setBusyPoll(fd, busy_poll), "setBusyPoll() failed, error: " + std::string(strerror(errno)));
         }
         return fd;
     }
@@ -0,0 +1,121 @@
+#include "tcp_ring.h"
+
+namespace Common {
+    TCPRing::TCPRing(Logger& logger, bool sq_poll) : ring(TCPRingEntries, sq_poll), logger(logger) {
+        // tcp has no peer address per read, only the kernel receive timestamp travels in front of the payload
+        recv_msg.msg_namelen = 0;
+        recv_msg.msg_controllen = RX_TIMESTAMP_CONTROL_SIZE;
+    }
+
+    auto TCPRing::accept(int fd) noexcept -> void {
+        listen_fd = fd;
+        auto sqe = ring.getSqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK;
+        sqe->user_data = ACCEPT;
+    }
+
+    auto TCPRing::addSocket(TCPSocket* s) noexcept -> void {
+        // rings that only send never pay for the receive buffers
+        if (UNLIKELY(!ring.hasBufferRing()))
+            ring.setupBufferRing(TCPRingRecvBuffers, TCPRingRecvBufferSize);
+        armRecv(s);
+    }
+
+    auto TCPRing::armRecv(TCPSocket* s) noexcept -> void {
+        auto sqe = ring.getSqe();
+        sqe->opcode = IORING_OP_RECVMSG;
+        sqe->fd = s->fd;
+        sqe->addr = reinterpret_cast<__u64>(&recv_msg);
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = IoUring::BufferGroup;
+        sqe->user_data = reinterpret_cast<uint64_t>(s) | RECV;
+    }
+
+    auto TCPRing::removeSocket(TCPSocket* s) noexcept -> void {
+        auto sqe = ring.getSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = reinterpret_cast<uint64_t>(s) | RECV;
+        sqe->user_data = 0;
+    }
+
+    auto TCPRing::send(TCPSocket* s, const char* data, size_t len) noexcept -> void {
+        auto sqe = ring.getSqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = s->fd;
+        sqe->addr = reinterpret_cast<__u64>(data);
+        sqe->len = static_cast<__u32>(len);
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = reinterpret_cast<uint64_t>(s) | SEND;
+    }
+
+    auto TCPRing::poll() noexcept -> bool {
+        return poll([](TCPSocket* s, Nanos rx_time) {
+            s->recv_callback(s, rx_time);
+        });
+    }
+
+    auto TCPRing::onAccept(const io_uring_cqe* cqe) noexcept -> void {
+        if (cqe->res >= 0) {
+            logger.log("%:% %() % accepted socket:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str), cqe->res);
+            accept_callback(cqe->res);
+        } else {
+            logger.log("%:% %() % accept failed, error:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str), strerror(-cqe->res));
+        }
+
+        if (!(cqe->flags & IORING_CQE_F_MORE))
+            accept(listen_fd);
+    }
+
+    auto TCPRing::copyPayload(TCPSocket* s, const io_uring_cqe* cqe, Nanos* rx_time) noexcept -> size_t {
+        if (!(cqe->flags & IORING_CQE_F_BUFFER))
+            return 0;
+
+        const auto bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        const auto out = reinterpret_cast<const io_uring_recvmsg_out*>(ring.buffer(bid));
+        size_t payload_len = 0;
+
+        if (cqe->res > 0 && out->payloadlen > 0) {
+            const auto control = reinterpret_cast<const char*>(out + 1) + recv_msg.msg_namelen;
+            const auto payload = control + recv_msg.msg_controllen;
+            payload_len = out->payloadlen;
+
+            msghdr control_msg = {};
+            control_msg.msg_control = const_cast<char*>(control);
+            control_msg.msg_controllen = out->controllen;
+            *rx_time = getRxTimestamp(&control_msg);
+
+            // the provided buffer goes straight back to the kernel, the socket keeps its own contiguous ring
+            if (UNLIKELY(!s->recv_buffer.reserve(payload_len)))
+                FATAL("TCPSocket receive buffer full, recv_callback not keeping up. socket:" + std::to_string(s->fd) + " " + s->bufferStatsToString());
+            memcpy(s->recv_buffer.writePtr(), payload, payload_len);
+            s->recv_buffer.commitWrite(payload_len);
+
+            const auto user_time = getCurrentNanos();
+            logger.log("%:% %() % read socket:% len:% utime:% ktime:% diff:%\n", __FILE__, __LINE__, __FUNCTION__,
+                        Common::getCurrentTimeStr(&time_str), s->fd, s->recvSize(), user_time, *rx_time, (user_time - *rx_time));
+        }
+
+        ring.recycleBuffer(bid);
+        return payload_len;
+    }
+
+    auto TCPRing::recvStopped(TCPSocket* s, const io_uring_cqe* cqe, size_t payload_len) noexcept -> void {
+        if (cqe->res == -ECANCELED)
+            return;
+
+        // running out of provided buffers ends the multishot read, anything else means the connection is gone
+        if (cqe->res == -ENOBUFS || payload_len) {
+            armRecv(s);
+        } else {
+            logger.log("%:% %() % socket:% disconnected, error:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str), s->fd, cqe->res < 0 ? strerror(-cqe->res) : "eof");
+            s->recv_disconnected = true;
+            if (disconnect_callback)
+                disconnect_callback(s);
+        }
+    }
+}
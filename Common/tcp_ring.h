@@ -0,0 +1,111 @@
+#pragma once
+
+#include <functional>
+#include <sys/socket.h>
+#include "io_uring.h"
+#include "logging.h"
+#include "socket_utils.h"
+#include "tcp_socket.h"
+#include "time_utils.h"
+
+namespace Common {
+    constexpr unsigned TCPRingEntries = 4096;
+    // buffers shared by all the sockets of a ring that multishot reads pick from, data is copied out of them right away
+    constexpr unsigned TCPRingRecvBuffers = 1024;
+    constexpr size_t TCPRingRecvBufferSize = 16 * 1024;
+
+    // drives TCPSocket accepts, reads and writes through an io_uring instead of epoll and a syscall per socket
+    // reads and accepts are armed once (multishot), sends are queued by TCPSocket::flush() and everything
+    // queued is submitted with a single io_uring_enter() from poll(), a ring must only be used by one thread
+    struct TCPRing {
+        TCPRing(Logger& logger, bool sq_poll);
+
+        TCPRing() = delete;
+        TCPRing(const TCPRing&) = delete;
+        TCPRing(const TCPRing&&) = delete;
+        TCPRing& operator=(const TCPRing&) = delete;
+        TCPRing& operator=(const TCPRing&&) = delete;
+
+        // method for accepting every connection on a listening socket, accepted fds are handed to accept_callback
+        auto accept(int listen_fd) noexcept -> void;
+        // method for reading socket until it disconnects, received data goes through the socket's recv_callback
+        auto addSocket(TCPSocket* s) noexcept -> void;
+        // method for stopping reads of a socket
+        auto removeSocket(TCPSocket* s) noexcept -> void;
+        // method for queueing a send of len bytes of the socket's send_buffer, completes on a later poll()
+        auto send(TCPSocket* s, const char* data, size_t len) noexcept -> void;
+        // method for submitting queued work and dispatching completions, returns true if any data was read
+        auto poll() noexcept -> bool;
+        // as above, with on_recv(socket, rx_time) called for the data read instead of the socket's recv_callback
+        template<typename OnRecv>
+        auto poll(OnRecv&& on_recv) noexcept -> bool;
+
+    private:
+        // what a completion belongs to, kept in the low bits of user_data
+        enum Op : uint64_t {
+            ACCEPT = 1,
+            RECV = 2,
+            SEND = 3
+        };
+        static constexpr uint64_t OpMask = 3;
+
+        auto armRecv(TCPSocket* s) noexcept -> void;
+        template<typename OnRecv>
+        auto onRecv(TCPSocket* s, const io_uring_cqe* cqe, OnRecv& on_recv) noexcept -> bool;
+        // appends the payload of a read completion to the socket's recv_buffer, returns the bytes appended
+        auto copyPayload(TCPSocket* s, const io_uring_cqe* cqe, Nanos* rx_time) noexcept -> size_t;
+        // re-arms or ends reading a socket once its multishot read stopped
+        auto recvStopped(TCPSocket* s, const io_uring_cqe* cqe, size_t payload_len) noexcept -> void;
+        auto onAccept(const io_uring_cqe* cqe) noexcept -> void;
+
+    public:
+        IoUring ring;
+        // layout of the name and control data in front of every multishot recvmsg payload
+        msghdr recv_msg = {};
+        int listen_fd = -1;
+        // function to be called with newly accepted connections
+        std::function<void(int fd)> accept_callback;
+        // function to be called when a socket read fails or the peer closes the connection
+        std::function<void(TCPSocket* s)> disconnect_callback;
+        std::string time_str;
+        Logger& logger;
+    };
+
+    template<typename OnRecv>
+    auto TCPRing::poll(OnRecv&& on_recv) noexcept -> bool {
+        ring.submit();
+
+        bool received = false;
+        ring.forEachCompletion([&](const io_uring_cqe* cqe) {
+            auto socket = reinterpret_cast<TCPSocket*>(cqe->user_data & ~OpMask);
+            switch (cqe->user_data & OpMask) {
+                case ACCEPT:
+                    onAccept(cqe);
+                    break;
+                case RECV:
+                    received |= onRecv(socket, cqe, on_recv);
+                    break;
+                case SEND:
+                    socket->sendCompleted(cqe->res);
+                    break;
+                default: // cancellations
+                    break;
+            }
+        });
+
+        return received;
+    }
+
+    template<typename OnRecv>
+    auto TCPRing::onRecv(TCPSocket* s, const io_uring_cqe* cqe, OnRecv& on_recv) noexcept -> bool {
+        Nanos kernel_time = 0;
+        const auto payload_len = copyPayload(s, cqe, &kernel_time);
+        if (payload_len)
+            on_recv(s, kernel_time);
+
+        if (!(cqe->flags & IORING_CQE_F_MORE))
+            recvStopped(s, cqe, payload_len);
+
+        return (payload_len > 0);
+    }
+}
@@ -6,20 +6,55 @@ namespace Common {
     }
 
     auto TCPServer::defaultRecvCallback(TCPSocket* s, Nanos rx_time) noexcept -> void {
-        logger.log("%:% %() % TCPServer::defaultRecvCallback() socket:% len:% rx:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str), s->fd, s->next_recv_valid_index, rx_time);
+        logger.log("%:% %() % TCPServer::defaultRecvCallback() socket:% len:% rx:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str), s->fd, s->recvSize(), rx_time);
     }
 
     auto TCPServer::destroy() noexcept -> void {
         close(efd);
         efd = -1;
         listener_socket.destroy();
+        delete ring;
+        ring = nullptr;
+
+        for (auto socket : disconnect_sockets) {
+            if (!sockets.contains(socket))
+                delete socket;
+        }
+        for (auto socket : sockets)
+            delete socket;
+        sockets.sockets.clear();
+        receive_sockets.sockets.clear();
+        send_sockets.sockets.clear();
+        disconnect_sockets.sockets.clear();
+    }
+
+    auto TCPServer::init() noexcept -> void {
+        if (backend == TCPBackend::EPOLL) {
+            efd = epoll_create(1);
+            ASSERT(efd >= 0, "epoll_create() failed, error: " + std::string(strerror(errno)));
+            // the sockets still busy poll on their own reads if the kernel does not support it for epoll
+            if (busy_poll.enabled() && !setEpollBusyPoll(efd, busy_poll))
+                logger.log("%:% %() % epoll busy poll not supported, error:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str), strerror(errno));
+            return;
+        }
+
+        ring = new TCPRing(logger, backend == TCPBackend::IO_URING_SQPOLL);
+        ring->accept_callback = [this](int fd) {
+            acceptConnection(fd);
+        };
+        ring->disconnect_callback = [this](TCPSocket* socket) {
+            disconnect_sockets.add(socket);
+        };
     }
 
     auto TCPServer::listen(const std::string& iface, const int port) noexcept -> void {
-        efd = epoll_create(1);
-        ASSERT(efd >= 0, "epoll_create() failed, error: " + std::string(strerror(errno)));
+        init();
+        listener_socket.busy_poll = busy_poll;
         ASSERT(listener_socket.connect("", iface, port, true) >= 0, "listener_socket.connect() failed, error: " + std::string(strerror(errno)));
-        ASSERT(epoll_add(&listener_socket), "epoll_ctrl() failed, error: " + std::string(strerror(errno)));
+        if (ring)
+            ring->accept(listener_socket.fd);
+        else
+            ASSERT(epoll_add(&listener_socket), "epoll_ctrl() failed, error: " + std::string(strerror(errno)));
     }
 
     auto TCPServer::epoll_add(TCPSocket* s) noexcept -> bool {
@@ -32,20 +67,38 @@ namespace Common {
     }  
 
     auto TCPServer::rmv(TCPSocket* s) noexcept -> void {
-        epoll_rmv(s);
-        sockets.erase(std::remove(sockets.begin(), sockets.end(), s), sockets.end());
-        receive_sockets.erase(std::remove(receive_sockets.begin(), receive_sockets.end(), s), receive_sockets.end());
-        send_sockets.erase(std::remove(send_sockets.begin(), receive_sockets.end(), s), send_sockets.end());
-    
+        if (ring)
+            ring->removeSocket(s);
+        else
+            epoll_rmv(s);
+        sockets.remove(s);
+        receive_sockets.remove(s);
+        send_sockets.remove(s);
     }
 
     auto TCPServer::poll() noexcept -> void {
-        const int max_events = 1 + sockets.size();
-        for (auto socket : disconnect_sockets) {
-            rmv(socket);
+        for (size_t i = disconnect_sockets.size(); i-- > 0;) {
+            auto socket = disconnect_sockets[i];
+            if (sockets.contains(socket))
+                rmv(socket);
+
+            // the kernel may still be reading the send buffer of a send queued on the ring
+            if (socket->ringSendInFlight())
+                continue;
+
+            disconnect_sockets.remove(socket);
+            logger.log("%:% %() % removed socket:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str), socket->fd, socket->bufferStatsToString());
+            if (disconnect_callback)
+                disconnect_callback(socket);
+            if (recycle_sockets)
+                socket_pool.deallocate(socket);
         }
 
-        const int n = epoll_wait(efd, events, max_events, 0);
+        // accepts and reads complete on the ring, they are picked up by recv()
+        if (ring)
+            return;
+
+        const int n = epoll_wait(efd, events, static_cast<int>(std::size(events)), 0);
 
         bool have_new_connection = false;
         for (int i = 0; i < n; i++)
@@ -64,22 +117,19 @@ namespace Common {
 
                 // we have data to read from client socket
                 logger.log("%:% %() % EPOLLIN socket:%\n",__FILE__, __LINE__, __FUNCTION__,Common::getCurrentTimeStr(&time_str), socket->fd);
-                if(std::find(receive_sockets.begin(), receive_sockets.end(), socket) == receive_sockets.end())
-                    receive_sockets.push_back(socket);
+                receive_sockets.add(socket);
             } 
 
             // check if we can write to socket
             if (event.events & EPOLLOUT) {
                 logger.log("%:% %() % EPOLLOUT socket:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str), socket->fd);
-                if(std::find(send_sockets.begin(), send_sockets.end(), socket) == send_sockets.end())
-                    receive_sockets.push_back(socket);
+                send_sockets.add(socket);
             }
 
             // check if there was an error or connection was closed
             if (event.events & (EPOLLERR | EPOLLHUP)) {
                 logger.log("%:% %() % EPOLLERR socket:%\n", __FILE__, __LINE__, __FUNCTION__,Common::getCurrentTimeStr(&time_str), socket->fd); 
-                if(std::find(disconnect_sockets.begin(), disconnect_sockets.end(), socket) == disconnect_sockets.end())
-                    disconnect_sockets.push_back(socket);
+                disconnect_sockets.add(socket);
             }
         }
 
@@ -92,37 +142,64 @@ namespace Common {
             int fd = accept(listener_socket.fd, reinterpret_cast<sockaddr*>(&addr), &addr_len);
             if (fd == -1)
                 break;
-            
-            ASSERT(setNonBlocking(fd) && setNoDelay(fd), "Failed to set non-blocking or no-delay on socket:" + std::to_string(fd));
-            
-            logger.log("%:% %() % accepted socket:%\n", __FILE__, __LINE__, __FUNCTION__,Common::getCurrentTimeStr(&time_str), fd);
+
+            acceptConnection(fd);
+        }
+    }
+
+    auto TCPServer::acceptConnection(int fd) noexcept -> void {
+        ASSERT(setNonBlocking(fd) && setNoDelay(fd), "Failed to set non-blocking or no-delay on socket:" + std::to_string(fd));
         
-            TCPSocket* socket = new TCPSocket(logger);
-            socket->fd = fd;
-            socket->recv_callback = recv_callback;
+        logger.log("%:% %() % accepted socket:%\n", __FILE__, __LINE__, __FUNCTION__,Common::getCurrentTimeStr(&time_str), fd);
+
+        if (accept_callback)
+            accept_callback(fd);
+        else
+            addSocket(fd);
+    }
 
+    auto TCPServer::addSocket(int fd) noexcept -> void {
+        TCPSocket* socket = socket_pool.allocate();
+        socket->fd = fd;
+        socket->recv_callback = recv_callback;
+        socket->send_list = &send_sockets;
+
+        if (ring) {
+            ring->addSocket(socket);
+            socket->send_ring = ring;
+        } else {
             ASSERT(epoll_add(socket), "Unable to add socket: " + std::string(strerror(errno)));
-            
-            if(std::find(sockets.begin(), sockets.end(), socket) == sockets.end())
-                sockets.push_back(socket);
-            if(std::find(receive_sockets.begin(), receive_sockets.end(), socket) == receive_sockets.end())
-                receive_sockets.push_back(socket);
         }
+
+        sockets.add(socket);
+        // data may have arrived before the socket was added
+        receive_sockets.add(socket);
     }
 
-    auto TCPServer::sendAndRecv() noexcept -> void {
-        auto recv = false;
+    auto TCPServer::bufferMemory() noexcept -> size_t {
+        size_t memory = listener_socket.bufferMemory() + socket_pool.bufferMemory();
+        for (auto socket : sockets)
+            memory += socket->bufferMemory();
+        return memory;
+    }
 
-        std::for_each(receive_sockets.begin(), receive_sockets.end(), [&recv](TCPSocket* socket){
-            recv |= socket->sendAndRecv();
-        });
+    auto TCPServer::sendAndRecv() noexcept -> void {
+        CallbackHandler handler{*this};
+        sendAndRecv(handler);
+    }
 
-        if (recv)
-            recv_finished_callback();
+    auto TCPServer::recv() noexcept -> void {
+        CallbackHandler handler{*this};
+        recv(handler);
+    }
 
-        std::for_each(send_sockets.begin(), send_sockets.end(), [](TCPSocket* socket){
-            socket->sendAndRecv();
-        });
+    auto TCPServer::flush() noexcept -> void {
+        for (size_t i = send_sockets.size(); i-- > 0;) {
+            auto socket = send_sockets[i];
+            socket->flush();
+            if (!socket->sendSize() || socket->send_disconnected)
+                send_sockets.remove(socket);
+        }
     }
 
     auto TCPServer::listenAndServe(const std::string& iface, int port) noexcept -> void {
@@ -1,13 +1,90 @@
 #pragma once
 
 #include "tcp_socket.h"
+#include "tcp_ring.h"
 
 namespace Common {
+    // how TCPServer waits for and moves data
+    enum class TCPBackend : uint8_t {
+        EPOLL = 0, // epoll_wait() then a recvmsg() / send() per ready socket
+        IO_URING = 1, // multishot accept & reads, sends of a loop submitted together with one io_uring_enter()
+        IO_URING_SQPOLL = 2 // as IO_URING with a kernel thread picking up submissions, no syscalls while it is busy
+    };
+
+    inline auto tcpBackendToString(TCPBackend backend) -> std::string {
+        switch (backend) {
+            case TCPBackend::EPOLL:
+                return "EPOLL";
+            case TCPBackend::IO_URING:
+                return "IO_URING";
+            case TCPBackend::IO_URING_SQPOLL:
+                return "IO_URING_SQPOLL";
+        }
+        return "UNKNOWN";
+    }
+
+    // hands out TCPSockets, sockets of closed connections are kept and reused so accepting does not have to
+    // allocate and map new buffers every time
+    struct TCPSocketPool {
+        TCPSocketPool(Logger& logger, const SocketBufferCfg& buffers) : buffers(buffers), logger(logger) {}
+
+        ~TCPSocketPool() {
+            for (auto socket : free_sockets)
+                delete socket;
+            free_sockets.clear();
+        }
+
+        TCPSocketPool() = delete;
+        TCPSocketPool(const TCPSocketPool&) = delete;
+        TCPSocketPool(const TCPSocketPool&&) = delete;
+        TCPSocketPool& operator=(const TCPSocketPool&) = delete;
+        TCPSocketPool& operator=(const TCPSocketPool&&) = delete;
+
+        // makes sure the next n allocations are served from the pool
+        auto reserve(size_t n) noexcept -> void {
+            while (free_sockets.size() < n)
+                free_sockets.push_back(new TCPSocket(logger, buffers));
+        }
+
+        auto allocate() noexcept -> TCPSocket* {
+            if (UNLIKELY(free_sockets.empty()))
+                return new TCPSocket(logger, buffers);
+
+            auto socket = free_sockets.back();
+            free_sockets.pop_back();
+            return socket;
+        }
+
+        // closes the socket's connection and keeps it for a later allocate()
+        auto deallocate(TCPSocket* socket) noexcept -> void {
+            socket->reset();
+            free_sockets.push_back(socket);
+        }
+
+        // bytes of memory the buffers of the pooled sockets can take up, they keep whatever they grew to
+        auto bufferMemory() const noexcept -> size_t {
+            size_t memory = 0;
+            for (auto socket : free_sockets)
+                memory += socket->bufferMemory();
+            return memory;
+        }
+
+        // buffer sizes of the sockets handed out
+        const SocketBufferCfg buffers;
+        std::vector<TCPSocket*> free_sockets;
+        Logger& logger;
+    };
+
     struct TCPServer {
-        explicit TCPServer(Logger& logger) : logger(logger), listener_socket(logger) {
+        explicit TCPServer(Logger& logger, TCPBackend backend = TCPBackend::EPOLL, const SocketBufferCfg& session_buffers = TCPSessionBufferCfg)
+            : logger(logger), listener_socket(logger, TCPListenerBufferCfg), backend(backend), socket_pool(logger, session_buffers) {
             
         }
 
+        ~TCPServer() {
+            destroy();
+        }
+
         TCPServer() = delete;
         TCPServer(const TCPServer&) = delete;
         TCPServer(const TCPServer&&) = delete;
@@ -20,12 +97,28 @@ namespace Common {
         auto defaultRecvFinishedCallback() noexcept -> void;
         // function for getting server up and running
         auto listenAndServe(const std::string& iface, int port) noexcept -> void;
+        // function for creating the epoll instance, servers that are handed sockets instead of listening only call this
+        auto init() noexcept -> void;
         // function for created and starting listening socket
         auto listen(const std::string& iface, const int port) noexcept -> void;
+        // function for taking ownership of an already accepted connection
+        auto addSocket(int fd) noexcept -> void;
         // function for send & receiving from socket
         auto sendAndRecv() noexcept -> void;
+        // function for only receiving from sockets, sending is left to whoever owns the send halves
+        auto recv() noexcept -> void;
+        // as above, with handler.onRecv(socket, rx_time) called for every read and handler.onRecvFinished() after them
+        // instead of recv_callback & recv_finished_callback, so the handler's parsing can be inlined into the read loop
+        template<typename Handler>
+        auto sendAndRecv(Handler& handler) noexcept -> void;
+        template<typename Handler>
+        auto recv(Handler& handler) noexcept -> void;
+        // function for sending the bytes queued on sockets
+        auto flush() noexcept -> void;
         // function for starting polling
         auto poll() noexcept -> void;
+        // function for summing up the memory the buffers of connected and pooled sockets can take up
+        auto bufferMemory() noexcept -> size_t;
         
     private:
         auto destroy() noexcept -> void;
@@ -35,17 +128,88 @@ namespace Common {
         auto epoll_rmv(TCPSocket* s) noexcept -> bool;  
         // function for removing socket from list of sockets
         auto rmv(TCPSocket* s) noexcept -> void;
+        // function for setting up a newly accepted connection
+        auto acceptConnection(int fd) noexcept -> void;
+
+        // handler that forwards to the std::function callbacks
+        struct CallbackHandler {
+            TCPServer& server;
+
+            auto onRecv(TCPSocket* s, Nanos rx_time) noexcept -> void {
+                s->recv_callback(s, rx_time);
+            }
+
+            auto onRecvFinished() noexcept -> void {
+                server.recv_finished_callback();
+            }
+        };
 
     public:
         int efd = -1;
         TCPSocket listener_socket;
+        const TCPBackend backend;
+        // only used by the io_uring backends
+        TCPRing* ring = nullptr;
+        // set before listen() / init(), applied to the listening socket (accepted ones inherit it) and the epoll instance
+        SocketBusyPollCfg busy_poll;
         epoll_event events[1024];
-        std::vector<TCPSocket*> sockets, send_sockets, receive_sockets, disconnect_sockets;
+        // connected sockets, sockets that may have data to read, sockets with bytes queued and sockets to be removed
+        // membership is tracked on the sockets, so the cost of an event does not depend on the number of connections
+        TCPSocketList sockets{TCP_LIST_ALL}, receive_sockets{TCP_LIST_RECEIVE}, send_sockets{TCP_LIST_SEND}, disconnect_sockets{TCP_LIST_DISCONNECT};
+        TCPSocketPool socket_pool;
+        // sockets of closed connections go back to socket_pool, turn off when other threads keep pointers to sessions
+        bool recycle_sockets = true;
         // function to be called when data is available
         std::function<void(TCPSocket *s, Nanos rx_time)> recv_callback;
         // function to be called when we finished reading the data;
         std::function<void()> recv_finished_callback;
+        // function to be called with newly accepted connections, when not set they are added to this server
+        std::function<void(int fd)> accept_callback;
+        // function to be called once for every connection that closed, after it was removed from the server
+        std::function<void(TCPSocket *s)> disconnect_callback;
         std::string time_str;
         Logger& logger;
     };
+
+    template<typename Handler>
+    auto TCPServer::sendAndRecv(Handler& handler) noexcept -> void {
+        // queue pending bytes first so they are submitted together with the next reads
+        if (ring) {
+            flush();
+            recv(handler);
+            return;
+        }
+
+        recv(handler);
+        flush();
+    }
+
+    template<typename Handler>
+    auto TCPServer::recv(Handler& handler) noexcept -> void {
+        if (ring) {
+            if (ring->poll([&handler](TCPSocket* s, Nanos rx_time) { handler.onRecv(s, rx_time); }))
+                handler.onRecvFinished();
+            return;
+        }
+
+        auto recv = false;
+        auto on_recv = [&handler](TCPSocket* s, Nanos rx_time) {
+            handler.onRecv(s, rx_time);
+        };
+
+        // epoll is edge triggered, a socket stays on the list until a read finds it drained and EPOLLIN puts it back
+        for (size_t i = receive_sockets.size(); i-- > 0;) {
+            auto socket = receive_sockets[i];
+            if (socket->recv(on_recv)) {
+                recv = true;
+            } else {
+                receive_sockets.remove(socket);
+                if (socket->recv_disconnected)
+                    disconnect_sockets.add(socket);
+            }
+        }
+
+        if (recv)
+            handler.onRecvFinished();
+    }
 }
@@ -1,8 +1,11 @@
 #include "tcp_socket.h"
+#include "tcp_ring.h"
+#include <linux/errqueue.h>
+#include <sstream>
 
 namespace Common {
     void TCPSocket::defaultRecvCallback(TCPSocket* s, Nanos rx_time) noexcept {
-        s->logger.log("%:% %() %TCPSocket::defaultRecvCallback() socket:% len:% rx:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&s->time_str), s->fd, s->next_recv_valid_index, rx_time);
+        s->logger.log("%:% %() %TCPSocket::defaultRecvCallback() socket:% len:% rx:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&s->time_str), s->fd, s->recvSize(), rx_time);
     }
 
     auto TCPSocket::destroy() noexcept -> void {
@@ -10,9 +13,25 @@ namespace Common {
         fd = -1;
     }
 
+    auto TCPSocket::reset() noexcept -> void {
+        destroy();
+        send_buffer.clear();
+        send_buffer.releaseOld();
+        recv_buffer.clear();
+        send_disconnected = recv_disconnected = false;
+        send_logger = &logger;
+        zero_copy = false;
+        next_zero_copy_id = 0;
+        inflight_bytes = inflight_head = inflight_count = 0;
+        send_ring = nullptr;
+        ring_send_len = 0;
+        list_index.fill(-1);
+        send_list = nullptr;
+    }
+
     auto TCPSocket::connect(const std::string& ip, const std::string& iface, int port, bool is_listening) -> int {
         destroy();
-        fd = createSocket(logger, ip, iface, port, false, false, is_listening, 0, true);
+        fd = createSocket(logger, ip, iface, port, false, false, is_listening, 0, true, busy_poll);
         
         inInAddr.sin_addr.s_addr = INADDR_ANY;
         inInAddr.sin_port = htons(port);
@@ -21,55 +40,157 @@ namespace Common {
     }
 
     auto TCPSocket::send(const void* data, size_t len) noexcept -> void {
-        mempcpy(send_buffer.data() + next_send_valid_index, data, len);
-        next_send_valid_index += len;
+        if (UNLIKELY(send_disconnected))
+            return;
+
+        // a send queued on the ring keeps reading the old mapping until it completes, a peer that stopped
+        // reading only costs its own session
+        if (UNLIKELY(!send_buffer.reserve(len, ringSendInFlight()))) {
+            disconnectSend("send buffer full");
+            return;
+        }
+
+        if (send_list && !send_buffer.size())
+            send_list->add(this);
+
+        memcpy(send_buffer.writePtr(), data, len);
+        send_buffer.commitWrite(len);
+    }
+
+    auto TCPSocket::enableZeroCopy() noexcept -> bool {
+        zero_copy = setZeroCopy(fd);
+        return zero_copy;
     }
 
     auto TCPSocket::sendAndRecv() noexcept -> bool {
-        char ctrl[CMSG_SPACE(sizeof(struct timeval))];
-        auto cmsg = reinterpret_cast<struct cmsghdr*>(&ctrl);
+        return sendAndRecv(recv_callback);
+    }
 
-        struct iovec iov;
-        iov.iov_base = recv_buffer.data() + next_recv_valid_index;
-        iov.iov_len = TCPBufferSize - next_recv_valid_index;
-        
-        msghdr msg;
-        msg.msg_control = ctrl;
-        msg.msg_controllen = sizeof(ctrl);
-        msg.msg_name = &inInAddr;
-        msg.msg_namelen = sizeof(inInAddr);
-        msg.msg_iov = &iov;
-        msg.msg_iovlen = 1;
-        
-        // Non-blocking call to read available data.
-        const auto read_size = recvmsg(fd, &msg, MSG_DONTWAIT);
-        if (read_size > 0) {
-            next_recv_valid_index += read_size;
-
-            Nanos kernel_time = 0;
-            timeval time_kernel;
-            if (cmsg->cmsg_level == SOL_SOCKET &&
-                cmsg->cmsg_type == SCM_TIMESTAMP &&
-                cmsg->cmsg_len == CMSG_LEN(sizeof(time_kernel))) {
-                memcpy(&time_kernel, CMSG_DATA(cmsg), sizeof(time_kernel));
-                kernel_time = time_kernel.tv_sec * NANOS_TO_SEC + time_kernel.tv_usec * NANOS_TO_MICROS; // convert timestamp to nanoseconds.
+    auto TCPSocket::recv() noexcept -> bool {
+        return recv(recv_callback);
+    }
+
+    auto TCPSocket::flush() noexcept -> void {
+        if (UNLIKELY(send_disconnected))
+            return;
+
+        if (send_ring) {
+            // bytes queued behind a send still in flight go out with the next one
+            if (!ring_send_len && send_buffer.size()) {
+                ring_send_len = send_buffer.size();
+                send_ring->send(this, send_buffer.readPtr(), ring_send_len);
             }
+            return;
+        }
 
-            const auto user_time = getCurrentNanos();
+        if (inflight_count)
+            reapZeroCopy();
 
-            logger.log("%:% %() % read socket:% len:% utime:% ktime:% diff:%\n", __FILE__, __LINE__, __FUNCTION__,
-                        Common::getCurrentTimeStr(&time_str), fd, next_recv_valid_index, user_time, kernel_time, (user_time - kernel_time));
-            recv_callback(this, kernel_time);
+        // bytes behind the ones the kernel already has
+        const auto unsent = send_buffer.size() - inflight_bytes;
+        if (unsent > 0) {
+            const auto n = sendPending(send_buffer.readPtr() + inflight_bytes, unsent);
+            send_logger->log("%:% %() % send socket:% len:% of:% queued:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&send_time_str), fd, n, unsent, send_buffer.size());
         }
+    }
+
+    auto TCPSocket::sendCompleted(int res) noexcept -> void {
+        send_logger->log("%:% %() % send socket:% len:% of:% queued:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&send_time_str), fd, res, ring_send_len, send_buffer.size());
+
+        // whatever the kernel did not take is still at the front of send_buffer for the next flush
+        if (res > 0)
+            send_buffer.commitRead(res);
+        else if (res != -EAGAIN && res != -EWOULDBLOCK && res != -ENOBUFS)
+            disconnectSend(strerror(-res));
+        ring_send_len = 0;
+        send_buffer.releaseOld();
+    }
+
+    auto TCPSocket::disconnectSend(const char* reason) noexcept -> void {
+        // a send that was in flight on the ring completes with an error after the shutdown
+        if (send_disconnected)
+            return;
 
-        if (next_send_valid_index > 0) {
-            // Non-blocking call to send data.
-            const auto n = ::send(fd, send_buffer.data(), next_send_valid_index, MSG_DONTWAIT | MSG_NOSIGNAL);
-            logger.log("%:% %() % send socket:% len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str), fd, n);
+        send_logger->log("%:% %() % socket:% disconnecting, % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&send_time_str), fd, reason, bufferStatsToString());
+        send_disconnected = true;
+        // the read side belongs to the server's thread, it sees eof and tears the session down like any other disconnect
+        ::shutdown(fd, SHUT_RDWR);
+    }
+
+    auto TCPSocket::bufferStatsToString() const -> std::string {
+        std::stringstream ss;
+        ss << "TCPSocketBuffers ["
+           << "send capacity:" << send_buffer.capacity() << " max:" << send_buffer.maxCapacity() << " high:" << send_buffer.highWater() << " grows:" << send_buffer.numGrows()
+           << " recv capacity:" << recv_buffer.capacity() << " max:" << recv_buffer.maxCapacity() << " high:" << recv_buffer.highWater() << " grows:" << recv_buffer.numGrows()
+           << "]";
+        return ss.str();
+    }
+
+    auto TCPSocket::sendPending(const char* data, size_t len) noexcept -> ssize_t {
+        const bool use_zero_copy = zero_copy && len >= TCPZeroCopyThreshold;
+        // zero copy sends and anything queued behind them have to be tracked until released
+        const bool track = use_zero_copy || inflight_count;
+        if (UNLIKELY(track && inflight_count == TCPMaxInflightSends))
+            return 0;
+
+        // Non-blocking call to send data.
+        const auto n = ::send(fd, data, len, MSG_DONTWAIT | MSG_NOSIGNAL | (use_zero_copy ? MSG_ZEROCOPY : 0));
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS)
+                disconnectSend(strerror(errno));
+            return n;
+        }
+
+        if (track) {
+            inflight_sends[(inflight_head + inflight_count++) % TCPMaxInflightSends] = {static_cast<size_t>(n), use_zero_copy ? next_zero_copy_id++ : 0, !use_zero_copy};
+            inflight_bytes += n;
+            releaseSent();
+        } else {
+            send_buffer.commitRead(n);
+        }
+
+        return n;
+    }
+
+    auto TCPSocket::reapZeroCopy() noexcept -> void {
+        char control[128];
+
+        while (true) {
+            msghdr msg = {};
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+
+            if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+                break;
+
+            for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) || (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)))
+                    continue;
+
+                sock_extended_err err;
+                memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+                if (err.ee_errno != 0 || err.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                    continue;
+
+                // notification covers zero copy sends with ids [ee_info, ee_data]
+                for (size_t i = 0; i < inflight_count; i++) {
+                    auto& inflight = inflight_sends[(inflight_head + i) % TCPMaxInflightSends];
+                    if (!inflight.done && static_cast<uint32_t>(inflight.zeroCopyId - err.ee_info) <= static_cast<uint32_t>(err.ee_data - err.ee_info))
+                        inflight.done = true;
+                }
+            }
         }
-        next_send_valid_index = 0;
 
-        return (read_size > 0);
+        releaseSent();
+    }
+
+    auto TCPSocket::releaseSent() noexcept -> void {
+        while (inflight_count && inflight_sends[inflight_head].done) {
+            send_buffer.commitRead(inflight_sends[inflight_head].len);
+            inflight_bytes -= inflight_sends[inflight_head].len;
+            inflight_head = (inflight_head + 1) % TCPMaxInflightSends;
+            inflight_count--;
+        }
     }
 
 }
\ No newline at end of file
@@ -1,21 +1,40 @@
 #pragma once
 
+#include <array>
 #include <functional>
 #include <stddef.h>
 #include <vector>
 #include "socket_utils.h"
 #include "logging.h"
+#include "mirrored_buffer.h"
 
 namespace Common {
-    constexpr size_t TCPBufferSize = 64 * 1024 * 1024;    
+    // listening sockets never carry data
+    constexpr SocketBufferCfg TCPListenerBufferCfg{4 * 1024, 4 * 1024};
+    // sessions start small and double whenever more bytes are unread or unsent than fit, so idle ones stay cheap
+    constexpr SocketBufferCfg TCPSessionBufferCfg{64 * 1024, 64 * 1024 * 1024};
+    // pending bytes at least this large are sent with MSG_ZEROCOPY when it is enabled on the socket
+    constexpr size_t TCPZeroCopyThreshold = 64 * 1024;
+    // max number of sends that can be waiting to be released while zero copy sends are in flight
+    constexpr size_t TCPMaxInflightSends = 256;
+
+    struct TCPRing;
+    struct TCPSocketList;
+
+    // lists a TCPServer keeps its sockets in, see TCPSocketList
+    constexpr size_t TCP_LIST_ALL = 0;
+    constexpr size_t TCP_LIST_RECEIVE = 1;
+    constexpr size_t TCP_LIST_SEND = 2;
+    constexpr size_t TCP_LIST_DISCONNECT = 3;
+    constexpr size_t TCP_NUM_LISTS = 4;
 
     struct TCPSocket {
-        explicit TCPSocket(Logger &logger): logger(logger) {
-            send_buffer.resize(TCPBufferSize);
-            recv_buffer.resize(TCPBufferSize);
+        explicit TCPSocket(Logger &logger, const SocketBufferCfg& buffers = TCPSessionBufferCfg)
+            : send_buffer(buffers.initial_size, buffers.max_size), recv_buffer(buffers.initial_size, buffers.max_size), logger(logger), send_logger(&logger) {
             recv_callback = [this](auto socket, auto rx_time) {
                 defaultRecvCallback(socket, rx_time);
             };
+            list_index.fill(-1);
         }
 
         TCPSocket() = delete;
@@ -33,25 +52,203 @@ namespace Common {
         auto destroy() noexcept -> void;
         // method for connection socket
         auto connect(const std::string& ip, const std::string& iface, int port, bool is_listening) -> int;
-        // method for sending data
+        // method for queueing data to be sent on the next flush
         auto send(const void* data, size_t len) noexcept -> void;
         // method for sending and receiving data
         auto sendAndRecv() noexcept -> bool;
+        // method for only reading available data, safe to call while another thread flushes
+        auto recv() noexcept -> bool;
+        // as above, with on_recv(socket, rx_time) called for the data read instead of recv_callback
+        // the handler's type is known at compile time, so its parsing can be inlined into the read
+        template<typename OnRecv>
+        auto sendAndRecv(OnRecv&& on_recv) noexcept -> bool;
+        template<typename OnRecv>
+        auto recv(OnRecv&& on_recv) noexcept -> bool;
+        // method for only publishing the data in send_buffer, safe to call while another thread reads
+        // all pending bytes go out in a single send, whatever the kernel does not accept stays queued for the next flush
+        auto flush() noexcept -> void;
+        // method for letting large flushes use MSG_ZEROCOPY, queued bytes are then released once the kernel is done with them
+        auto enableZeroCopy() noexcept -> bool;
+        // method for releasing the bytes a send queued on send_ring got through, res is the send's result
+        auto sendCompleted(int res) noexcept -> void;
+        // method for closing the connection and clearing all state so the socket can be reused for another one
+        auto reset() noexcept -> void;
+        // method for describing how big the buffers are and how full they got
+        auto bufferStatsToString() const -> std::string;
+
+        // bytes of memory the send & receive buffers can take up
+        auto bufferMemory() const noexcept -> size_t {
+            return send_buffer.capacity() + recv_buffer.capacity();
+        }
+
+        // a send queued on send_ring that the kernel may still be reading send_buffer for
+        auto ringSendInFlight() const noexcept -> bool {
+            return (ring_send_len != 0);
+        }
 
+        // bytes queued for sending that have not been released yet
+        auto sendSize() const noexcept -> size_t {
+            return send_buffer.size();
+        }
+
+        // received bytes not consumed yet, always contiguous
+        auto recvData() const noexcept -> const char* {
+            return recv_buffer.readPtr();
+        }
 
+        auto recvSize() const noexcept -> size_t {
+            return recv_buffer.size();
+        }
+
+        // marks len received bytes as consumed
+        auto commitRecv(size_t len) noexcept -> void {
+            recv_buffer.commitRead(len);
+        }
+
+
+    private:
+        // method for handing len bytes to the kernel, returns bytes accepted
+        auto sendPending(const char* data, size_t len) noexcept -> ssize_t;
+        // method for reading zero copy completions from the error queue
+        auto reapZeroCopy() noexcept -> void;
+        // method for releasing the sent bytes at the front of send_buffer the kernel no longer needs
+        auto releaseSent() noexcept -> void;
+        // method for dropping everything still to be sent and shutting the connection down
+        auto disconnectSend(const char* reason) noexcept -> void;
+
+        // bytes handed to the kernel by a single send, zero copy ones are only released on completion
+        struct InflightSend {
+            size_t len = 0;
+            uint32_t zeroCopyId = 0;
+            bool done = false;
+        };
+
+    public:
         int fd = -1;
-        std::vector<char> send_buffer;
-        size_t next_send_valid_index = 0;
-        std::vector<char> recv_buffer;
-        size_t next_recv_valid_index = 0;
+        MirroredBuffer send_buffer;
+        MirroredBuffer recv_buffer;
         bool send_disconnected = false;
         bool recv_disconnected = false;
         struct sockaddr_in inInAddr;
+        // applied by connect(), accepted sockets inherit the listening socket's
+        SocketBusyPollCfg busy_poll;
         
         std::function<void(TCPSocket* s, Nanos rx_time)> recv_callback;
         std::string time_str;
         Logger& logger;
+        // logger used by flush(), can be pointed to a different logger when the send half is owned by another thread
+        Logger* send_logger = nullptr;
+        std::string send_time_str;
+
+        // zero copy bookkeeping, only used by the thread owning the send half
+        bool zero_copy = false;
+        uint32_t next_zero_copy_id = 0;
+        // bytes of send_buffer already handed to the kernel but not released yet
+        size_t inflight_bytes = 0;
+        std::array<InflightSend, TCPMaxInflightSends> inflight_sends;
+        size_t inflight_head = 0, inflight_count = 0;
+
+        // when set flush() queues a send on this ring instead of calling send(), one at a time
+        TCPRing* send_ring = nullptr;
+        size_t ring_send_len = 0;
+
+        // position in each of the owning TCPServer's lists, -1 when not a member
+        std::array<int32_t, TCP_NUM_LISTS> list_index;
+        // list send() puts the socket on when bytes get queued on an empty send_buffer, only touched by the sending thread
+        TCPSocketList* send_list = nullptr;
 
         static void defaultRecvCallback(TCPSocket* s, Nanos rx_time) noexcept;
     };
-}
\ No newline at end of file
+
+    // vector of sockets with O(1) add, contains and remove, every socket keeps its own index into the list
+    // remove() moves the last socket into the freed slot, so removing while iterating has to go backwards
+    struct TCPSocketList {
+        explicit TCPSocketList(size_t id) : id(id) {}
+
+        auto contains(const TCPSocket* s) const noexcept -> bool {
+            return (s->list_index[id] >= 0);
+        }
+
+        auto add(TCPSocket* s) noexcept -> void {
+            if (contains(s))
+                return;
+            s->list_index[id] = static_cast<int32_t>(sockets.size());
+            sockets.push_back(s);
+        }
+
+        auto remove(TCPSocket* s) noexcept -> void {
+            if (!contains(s))
+                return;
+            auto last = sockets.back();
+            sockets[s->list_index[id]] = last;
+            last->list_index[id] = s->list_index[id];
+            sockets.pop_back();
+            s->list_index[id] = -1;
+        }
+
+        auto size() const noexcept -> size_t {
+            return sockets.size();
+        }
+
+        auto operator[](size_t i) const noexcept -> TCPSocket* {
+            return sockets[i];
+        }
+
+        auto begin() noexcept {
+            return sockets.begin();
+        }
+
+        auto end() noexcept {
+            return sockets.end();
+        }
+
+        const size_t id;
+        std::vector<TCPSocket*> sockets;
+    };
+
+    template<typename OnRecv>
+    auto TCPSocket::sendAndRecv(OnRecv&& on_recv) noexcept -> bool {
+        const auto received = recv(on_recv);
+        flush();
+        return received;
+    }
+
+    template<typename OnRecv>
+    auto TCPSocket::recv(OnRecv&& on_recv) noexcept -> bool {
+        char ctrl[RX_TIMESTAMP_CONTROL_SIZE];
+
+        // grow once half the buffer holds unconsumed bytes instead of chopping what the peer sends into ever smaller reads
+        if (UNLIKELY(recv_buffer.freeSpace() < recv_buffer.capacity() / 2))
+            recv_buffer.reserve(recv_buffer.capacity() / 2 + 1);
+
+        struct iovec iov;
+        iov.iov_base = recv_buffer.writePtr();
+        iov.iov_len = recv_buffer.freeSpace();
+        
+        msghdr msg;
+        msg.msg_control = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+        msg.msg_name = &inInAddr;
+        msg.msg_namelen = sizeof(inInAddr);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        
+        // Non-blocking call to read available data.
+        const auto read_size = recvmsg(fd, &msg, MSG_DONTWAIT);
+        if (read_size > 0) {
+            recv_buffer.commitWrite(read_size);
+
+            const auto kernel_time = getRxTimestamp(&msg);
+            const auto user_time = getCurrentNanos();
+
+            logger.log("%:% %() % read socket:% len:% utime:% ktime:% diff:%\n", __FILE__, __LINE__, __FUNCTION__,
+                        Common::getCurrentTimeStr(&time_str), fd, recvSize(), user_time, kernel_time, (user_time - kernel_time));
+            on_recv(this, kernel_time);
+        } else if (read_size == 0 && iov.iov_len) {
+            // orderly shutdown by the peer
+            recv_disconnected = true;
+        }
+
+        return (read_size > 0);
+    }
+}
@@ -5,11 +5,12 @@
 #include <cstdint>
 #include <sstream>
 #include <array>
+#include <type_traits>
+#include <vector>
 
 namespace Common {
     // limits used in our system
     constexpr size_t LOG_QUEUE_SIZE = 8 * 1024 * 1024; // size of logger
-    constexpr size_t ME_MAX_TICKERS = 8; // # of trading instruments supported by exchange
     // max number of unprocessed requests from all clients that matching engine has not processed yet
     // && also represents the max number of responses that order server has not published yet
     constexpr size_t ME_MAX_CLIENT_UPDATES = 256 * 1024; 
@@ -17,18 +18,50 @@ namespace Common {
     constexpr size_t ME_MAX_MARKET_UPDATES = 256 * 1024;
     // max number of simultaneous market participants
     constexpr size_t ME_MAX_CLIENTS = 256;
-    // max number of orders for specific trading instrument
-    constexpr size_t ME_MAX_ORDER_IDS = 1024 * 1024;
-    // max price depth of price levels maintained by matching engine
-    constexpr size_t ME_MAX_PRICE_LEVELS = 256;
+    // max number of tickers a single mass quote carries
+    constexpr size_t ME_MAX_MASS_QUOTE_ENTRIES = 64;
+    // instruments, their price levels & order counts are listed at runtime in an InstrumentRegistry
+
+    // widths of prices, quantities & order ids, the policy is picked at build time (HFT_COMPACT_SCALARS)
+    struct WideScalars {
+        typedef uint64_t OrderId;
+        typedef int64_t Price;
+        typedef uint32_t Qty;
+        typedef uint64_t Priority;
+        typedef uint64_t SeqNum;
+    };
+
+    // 32 bit prices (in ticks), order ids & priorities: smaller orders & books, instruments have to keep their prices
+    // and order counts below 2^31, which InstrumentRegistry checks when they are listed
+    struct CompactScalars {
+        typedef uint32_t OrderId;
+        typedef int32_t Price;
+        typedef uint32_t Qty;
+        typedef uint32_t Priority;
+        typedef uint64_t SeqNum; // sequence numbers of the market data streams count every update ever sent, never narrowed
+    };
+
+#ifdef HFT_COMPACT_SCALARS
+    typedef CompactScalars ScalarTraits;
+#else
+    typedef WideScalars ScalarTraits;
+#endif
 
     // basic types used
-    typedef uint64_t OrderId;
+    typedef ScalarTraits::OrderId OrderId;
     typedef uint32_t TickerId;
     typedef uint32_t ClientId;
-    typedef int64_t Price;
-    typedef uint32_t Qty;
-    typedef uint64_t Priority;
+    typedef ScalarTraits::Price Price;
+    typedef ScalarTraits::Qty Qty;
+    typedef ScalarTraits::Priority Priority;
+    typedef ScalarTraits::SeqNum SeqNum;
+
+    // the largest value of each type is its INVALID, prices go negative (spreads, pnl) and everything else counts up
+    static_assert(std::is_signed_v<Price> && std::is_integral_v<Price>, "Price has to be a signed integer");
+    static_assert(std::is_unsigned_v<OrderId> && std::is_unsigned_v<Qty> && std::is_unsigned_v<Priority>, "ids, quantities & priorities have to be unsigned");
+    // a fill's leaves qty is a Qty and the queue position of an order a Priority, an order id can never run past either
+    static_assert(sizeof(Priority) >= sizeof(Qty) && sizeof(OrderId) >= sizeof(Qty), "Priority & OrderId have to be at least as wide as Qty");
+    static_assert(std::is_unsigned_v<SeqNum> && sizeof(SeqNum) >= sizeof(size_t), "SeqNum has to hold any count of updates");
 
     
     constexpr auto OrderId_INVALID = std::numeric_limits<OrderId>::max();
@@ -137,8 +170,8 @@ namespace Common {
         }
     };
 
-    // array that holds configuration for all possible tickers
-    typedef std::array<TradingEngineCfg, ME_MAX_TICKERS> TradingEngineCfgHashMap;
+    // configuration of every listed ticker, indexed by ticker id
+    typedef std::vector<TradingEngineCfg> TradingEngineCfgHashMap;
 
 
     // enumeration representing trading algorithms
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "macros.h"
+
+namespace Common {
+    // fields go out little endian, as they are in memory
+    static_assert(std::endian::native == std::endian::little, "wire codec expects a little endian host");
+
+    // schema all our messages belong to
+    constexpr uint16_t WIRE_SCHEMA_ID = 1;
+
+    // in front of every message (SBE style): the length of the fixed block that follows, which message it is and the
+    // schema version it was encoded with, a receiver skips messages it does not know by blockLength and decodes the
+    // fields of an older or newer version it shares with the sender
+    struct WireMessageHeader {
+        uint16_t blockLength = 0;
+        uint16_t templateId = 0;
+        uint16_t schemaId = 0;
+        uint16_t version = 0;
+    };
+    constexpr size_t WIRE_HEADER_SIZE = 4 * sizeof(uint16_t);
+
+    // function for reading the header at the start of a message
+    inline auto decodeWireHeader(const char* in) noexcept -> WireMessageHeader {
+        uint16_t fields[4];
+        memcpy(fields, in, WIRE_HEADER_SIZE);
+        return {fields[0], fields[1], fields[2], fields[3]};
+    }
+
+    // converts value to the width it has on the wire, the largest value of a type (the INVALID of our types) maps
+    // to the largest value of the wire type, anything else has to fit
+    template<typename Wire, typename T>
+    inline auto toWire(T value) noexcept -> Wire {
+        static_assert(std::is_integral_v<Wire>, "wire fields are integers");
+        if constexpr (std::is_enum_v<T>) {
+            return static_cast<Wire>(static_cast<std::underlying_type_t<T>>(value));
+        } else if constexpr (std::is_same_v<Wire, T>) {
+            return value;
+        } else {
+            if (value == std::numeric_limits<T>::max())
+                return std::numeric_limits<Wire>::max();
+            if (UNLIKELY(!std::in_range<Wire>(value) || value == std::numeric_limits<Wire>::max()))
+                FATAL("value:" + std::to_string(value) + " does not fit its wire field");
+            return static_cast<Wire>(value);
+        }
+    }
+
+    // converts a wire value back, the inverse of toWire()
+    template<typename T, typename Wire>
+    inline auto fromWire(Wire value) noexcept -> T {
+        if constexpr (std::is_enum_v<T>) {
+            return static_cast<T>(static_cast<std::underlying_type_t<T>>(value));
+        } else if constexpr (std::is_same_v<Wire, T>) {
+            return value;
+        } else {
+            // a build with narrower types than the wire (HFT_COMPACT_SCALARS) sees what it cannot hold as INVALID
+            if (value == std::numeric_limits<Wire>::max() || !std::in_range<T>(value))
+                return std::numeric_limits<T>::max();
+            return static_cast<T>(value);
+        }
+    }
+
+    // a field of a message: the integer type it has on the wire and the path of members to it, fields are laid out in
+    // the order they are listed, fields added by a later version go at the end
+    template<typename Wire, auto... Path>
+    struct WireField {
+        static constexpr size_t Size = sizeof(Wire);
+
+        template<typename Msg>
+        static auto encode(const Msg& msg, char* out) noexcept -> void {
+            const auto wire = toWire<Wire>((msg .* ... .* Path));
+            memcpy(out, &wire, Size);
+        }
+
+        template<typename Msg>
+        static auto decode(const char* in, Msg& msg) noexcept -> void {
+            Wire wire;
+            memcpy(&wire, in, Size);
+            auto& value = (msg .* ... .* Path);
+            value = fromWire<std::remove_reference_t<decltype(value)>>(wire);
+        }
+    };
+
+    // encodes & decodes Msg as the fixed block of message TemplateId, the layout is generated from the fields listed
+    template<typename Msg, uint16_t TemplateId, uint16_t Version, typename... Fields>
+    struct WireCodec {
+        static constexpr uint16_t templateId = TemplateId;
+        static constexpr uint16_t version = Version;
+        static constexpr size_t BlockLength = (Fields::Size + ...);
+        static constexpr size_t MessageLength = WIRE_HEADER_SIZE + BlockLength;
+
+        // method for writing the fields of msg, BlockLength bytes
+        static auto encodeBlock(const Msg& msg, char* out) noexcept -> void {
+            size_t offset = 0;
+            ((Fields::encode(msg, out + offset), offset += Fields::Size), ...);
+        }
+
+        // method for reading a block of blockLength bytes, fields it does not carry (an older sender) keep their value
+        // in msg and fields we do not know (a newer sender) are skipped
+        static auto decodeBlock(const char* in, size_t blockLength, Msg& msg) noexcept -> void {
+            size_t offset = 0;
+            ((offset + Fields::Size <= blockLength ? (Fields::decode(in + offset, msg), offset += Fields::Size) : offset), ...);
+        }
+
+        // method for writing header & block of msg, returns MessageLength
+        static auto encode(const Msg& msg, char* out) noexcept -> size_t {
+            const uint16_t header[] = {static_cast<uint16_t>(BlockLength), TemplateId, WIRE_SCHEMA_ID, Version};
+            memcpy(out, header, WIRE_HEADER_SIZE);
+            encodeBlock(msg, out + WIRE_HEADER_SIZE);
+            return MessageLength;
+        }
+
+        // method for reading a complete message (see wireMessageLength()), returns false if it is not one of ours
+        static auto decode(const char* in, Msg& msg) noexcept -> bool {
+            const auto header = decodeWireHeader(in);
+            if (UNLIKELY(header.templateId != TemplateId || header.schemaId != WIRE_SCHEMA_ID))
+                return false;
+            decodeBlock(in + WIRE_HEADER_SIZE, header.blockLength, msg);
+            return true;
+        }
+    };
+
+    // function for the length of the message at the start of len bytes, 0 if it did not arrive in full yet
+    inline auto wireMessageLength(const char* in, size_t len) noexcept -> size_t {
+        if (len < WIRE_HEADER_SIZE)
+            return 0;
+        const auto length = WIRE_HEADER_SIZE + decodeWireHeader(in).blockLength;
+        return (length <= len ? length : 0);
+    }
+
+    // in front of the entries of a repeating group that follows the fixed block of a message (SBE style): the length of
+    // an entry & how many follow, a receiver reads the entry fields it knows and steps over the rest by blockLength
+    struct WireGroupHeader {
+        uint16_t blockLength = 0;
+        uint16_t numInGroup = 0;
+    };
+    constexpr size_t WIRE_GROUP_HEADER_SIZE = 2 * sizeof(uint16_t);
+
+    // function for reading the group header at in
+    inline auto decodeWireGroupHeader(const char* in) noexcept -> WireGroupHeader {
+        uint16_t fields[2];
+        memcpy(fields, in, WIRE_GROUP_HEADER_SIZE);
+        return {fields[0], fields[1]};
+    }
+
+    // function for writing the group header at out
+    inline auto encodeWireGroupHeader(const WireGroupHeader& header, char* out) noexcept -> void {
+        const uint16_t fields[] = {header.blockLength, header.numInGroup};
+        memcpy(out, fields, WIRE_GROUP_HEADER_SIZE);
+    }
+
+    // function for the length of a message with a single group after its fixed block at the start of len bytes, 0 if
+    // it did not arrive in full yet, the header's blockLength only covers the fixed block so wireMessageLength() can not
+    // frame these
+    inline auto wireGroupMessageLength(const char* in, size_t len) noexcept -> size_t {
+        const auto blockEnd = wireMessageLength(in, len);
+        if (!blockEnd || blockEnd + WIRE_GROUP_HEADER_SIZE > len)
+            return 0;
+        const auto group = decodeWireGroupHeader(in + blockEnd);
+        const auto length = blockEnd + WIRE_GROUP_HEADER_SIZE + static_cast<size_t>(group.blockLength) * group.numInGroup;
+        return (length <= len ? length : 0);
+    }
+}
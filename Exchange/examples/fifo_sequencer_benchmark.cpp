@@ -0,0 +1,48 @@
+#include <random>
+#include "time_utils.h"
+#include "logging.h"
+#include "fifo_sequencer.h"
+
+using namespace Common;
+
+// measures FifoSequencer::sequenceAndPublish() cost when every session contributes a run of requests to a batch
+int main(int, char **) {
+    Logger logger("fifo_sequencer_benchmark.log");
+    Exchange::ClientRequestRouter clientRequests(1);
+    Exchange::FifoSequencer fifoSequencer(&clientRequests, &logger);
+
+    std::mt19937_64 rng(42);
+    const size_t requestsPerSession = 4;
+    const size_t passes = 100;
+
+    for (const size_t sessions : {10, 100, 1000}) {
+        Nanos totalTime = 0;
+        std::uniform_int_distribution<Nanos> rxTimeDist(0, 1000 * NANOS_TO_MICROS);
+
+        for (size_t pass = 0; pass < passes; pass++) {
+            // every session read gives a run of requests sharing increasing receive times
+            for (size_t session = 0; session < sessions; session++) {
+                const auto rxTime = rxTimeDist(rng);
+                for (size_t i = 0; i < requestsPerSession; i++)
+                    fifoSequencer.addClientRequest(rxTime + i, {Exchange::ClientRequestType::NEW, static_cast<ClientId>(session), 0, i, Side::Buy, 100, 10});
+            }
+
+            const auto start = getCurrentNanos();
+            fifoSequencer.sequenceAndPublish();
+            totalTime += getCurrentNanos() - start;
+
+            while (clientRequests.shardRequests(0)->getNextRead())
+                clientRequests.shardRequests(0)->updateReadIndex();
+
+            // give the logger a chance to drain
+            using namespace std::literals::chrono_literals;
+            std::this_thread::sleep_for(50ms);
+        }
+
+        std::cout << "sessions:" << sessions << " requests/pass:" << sessions * requestsPerSession
+                  << " ns/pass:" << totalTime / passes << " ns/request:" << totalTime / static_cast<Nanos>(passes * sessions * requestsPerSession)
+                  << " reorder-rate:" << fifoSequencer.reorderRate() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "time_utils.h"
+#include "logging.h"
+#include "mcast_socket.h"
+#include "mdp_packet_writer.h"
+
+using namespace Common;
+
+// measures incremental market data throughput on loopback when every matching engine batch of updates is packed into
+// mtu sized packets, publisher and consumer are driven from the same thread
+int main(int, char **) {
+    Logger logger("market_data_packet_benchmark.log");
+
+    const std::string iface = "lo";
+    const std::string ip = "239.0.0.1";
+    const size_t numUpdates = 200 * 1000;
+
+    std::cout << "updates per packet:" << Exchange::MDP_MAX_UPDATES_PER_PACKET << " update bytes on the wire:" << Exchange::MDPMarketUpdateCodec::BlockLength
+              << " in memory:" << sizeof(Exchange::MDPMarketUpdate) << std::endl;
+
+    int port = 20600;
+    for (const size_t batch : {1, 16, 256}) {
+        McastSocket publisher(logger);
+        ASSERT(publisher.init(ip, iface, port, false) >= 0, "Unable to create publisher, error: " + std::string(strerror(errno)));
+        Exchange::MDPPacketWriter writer(&publisher, Exchange::MDP_INCREMENTAL_CHANNEL);
+        McastSocket consumer(logger);
+        ASSERT(consumer.init(ip, iface, port, true) >= 0, "Unable to create consumer, error: " + std::string(strerror(errno)));
+        ASSERT(consumer.join(ip), "Join failed, error: " + std::string(strerror(errno)));
+
+        size_t received = 0, packets = 0, gaps = 0, nextSeqNum = 1;
+        auto onRecv = [&](McastSocket* socket, Nanos) {
+            Exchange::MDPPacketHeader header;
+            ASSERT(Exchange::MDPPacketHeaderCodec::decode(socket->recvData(), header), "Not a market data packet");
+            gaps += (header.firstSeqNumber != nextSeqNum);
+            nextSeqNum = header.firstSeqNumber + header.numUpdates;
+            // decode the updates as a consumer would
+            const auto updates = socket->recvData() + Exchange::MDPPacketHeaderCodec::MessageLength;
+            for (size_t i = 0; i < header.numUpdates; i++) {
+                Exchange::MDPMarketUpdate update;
+                Exchange::MDPMarketUpdateCodec::decodeBlock(updates + i * header.updateLength, header.updateLength, update);
+                received += (update.meMarketUpdate.type == Exchange::MarketUpdateType::ADD);
+            }
+            packets++;
+        };
+
+        size_t seqNum = 1;
+        const auto start = getCurrentNanos();
+        while (seqNum <= numUpdates) {
+            for (size_t i = 0; i < batch; i++)
+                writer.add(Exchange::MDPMarketUpdate{seqNum++, {Exchange::MarketUpdateType::ADD, seqNum, 1, Side::Buy, 100, 10, 1}});
+            writer.flush();
+            consumer.sendAndRecv(onRecv);
+        }
+
+        // a few empty reads mean whatever is missing was dropped
+        for (size_t idle = 0; received < seqNum - 1 && idle < 1000;)
+            idle += !consumer.sendAndRecv(onRecv);
+        const auto elapsed = getCurrentNanos() - start;
+
+        std::cout << "batch:" << batch << " updates/sec:" << received * NANOS_TO_SEC / elapsed
+                  << " received:" << received << " of:" << seqNum - 1 << " packets:" << packets << " gaps:" << gaps << std::endl;
+        port++;
+    }
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include "time_utils.h"
+#include "logging.h"
+#include "matching_shard.h"
+
+using namespace Common;
+
+// resident set size of the process in bytes
+static auto residentBytes() -> size_t {
+    size_t pages = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// drains what the books sent through the engine and gives the logger a chance to catch up
+static auto drain(Exchange::ClientResponseLFQueue& clientResponses, Exchange::MEMarketUpdateLFQueue& marketUpdates) -> void {
+    while (clientResponses.getNextRead())
+        clientResponses.updateReadIndex();
+    while (marketUpdates.getNextRead())
+        marketUpdates.updateReadIndex();
+    using namespace std::literals::chrono_literals;
+    std::this_thread::sleep_for(50ms);
+}
+
+// measures the memory an order book takes and the cost of matching with the scalar widths of the build (build it
+// as is and with -DHFT_COMPACT_SCALARS to compare the two policies), then the cost of adding a price level behind
+// books of growing depth for each OrderBookType
+int main(int, char **) {
+    Logger logger("order_book_benchmark.log");
+    Exchange::ClientRequestRouter clientRequests(1);
+    Exchange::ClientResponseLFQueue clientResponses(ME_MAX_CLIENT_UPDATES);
+    Exchange::MEMarketUpdateLFQueue marketUpdates(ME_MAX_MARKET_UPDATES);
+    // the shard is only there for the books to send responses & updates through, it is never started
+    Exchange::MatchingShard matchingShard(0, &clientRequests, &clientResponses, &marketUpdates, InstrumentRegistry());
+
+    std::cout << "scalars:" << (std::is_same_v<ScalarTraits, CompactScalars> ? "compact" : "wide")
+              << " sizeof(MEOrder):" << sizeof(Exchange::MEOrder) << " sizeof(MEOrderAtPrice):" << sizeof(Exchange::MEOrderAtPrice)
+              << " sizeof(MEClientResponse):" << sizeof(Exchange::MEClientResponse) << " sizeof(MEMarketUpdate):" << sizeof(Exchange::MEMarketUpdate) << std::endl;
+
+    const InstrumentCfg instrument{0, "BENCH", 1, 0, 1024, 1024, 4 * 1024 * 1024};
+    const auto rssBefore = residentBytes();
+    Exchange::MEOrderBook book(instrument, &logger, &matchingShard);
+    std::cout << "orders:" << instrument.maxOrders << " book MB:" << (residentBytes() - rssBefore) / (1024 * 1024) << std::endl;
+
+    // every round rests orders on 8 ask levels for one client and sweeps them with a single buy from another, the
+    // warm up rounds are not timed, they get the page faults of the loggers' queues out of the way
+    const size_t warmupRounds = 100;
+    const size_t rounds = 100;
+    const size_t ordersPerLevel = 16;
+    const Price levels = 8;
+    Nanos restTime = 0, sweepTime = 0;
+    size_t fills = 0;
+    for (size_t round = 0; round < warmupRounds + rounds; round++) {
+        if (round == warmupRounds) {
+            restTime = sweepTime = 0;
+            fills = 0;
+        }
+
+        OrderId orderId = 0;
+        auto start = getCurrentNanos();
+        for (Price level = 0; level < levels; level++) {
+            for (size_t i = 0; i < ordersPerLevel; i++)
+                book.add(0, orderId++, 0, Side::Sell, 500 + level, 10);
+        }
+        restTime += getCurrentNanos() - start;
+
+        start = getCurrentNanos();
+        book.add(1, 0, 0, Side::Buy, 500 + levels, static_cast<Qty>(orderId * 10));
+        sweepTime += getCurrentNanos() - start;
+        fills += orderId;
+
+        drain(clientResponses, marketUpdates);
+    }
+
+    const auto orders = rounds * levels * ordersPerLevel;
+    std::cout << "ns/resting-add:" << restTime / static_cast<Nanos>(orders) << " ns/fill:" << sweepTime / static_cast<Nanos>(fills) << std::endl;
+
+    // rests an ask on depth levels in random order, then times orders that open a level behind all of them and are
+    // canceled again right away
+    const InstrumentCfg ladderInstrument{0, "BENCH", 1, 0, 1 << 16, 8192, 64 * 1024};
+    std::mt19937_64 rng(42);
+    for (const auto type : {Exchange::OrderBookType::LINKED_LIST, Exchange::OrderBookType::PRICE_LADDER}) {
+        for (const Price depth : {16, 256, 4096}) {
+            Exchange::MEOrderBook depthBook(ladderInstrument, &logger, &matchingShard, type);
+            std::vector<Price> prices(depth);
+            std::iota(prices.begin(), prices.end(), 1000);
+            std::shuffle(prices.begin(), prices.end(), rng);
+            OrderId orderId = 0;
+            for (const auto price : prices) {
+                depthBook.add(0, orderId++, 0, Side::Sell, price, 10);
+                if (orderId % 1024 == 0)
+                    drain(clientResponses, marketUpdates);
+            }
+            drain(clientResponses, marketUpdates);
+
+            const size_t newLevels = 4096;
+            Nanos addTime = 0;
+            for (size_t i = 0; i < newLevels; i++) {
+                const auto start = getCurrentNanos();
+                depthBook.add(1, i, 0, Side::Sell, 1000 + depth + static_cast<Price>(i % 16), 10);
+                addTime += getCurrentNanos() - start;
+                depthBook.cancel(1, i, 0);
+                if (i % 256 == 255)
+                    drain(clientResponses, marketUpdates);
+            }
+
+            std::cout << "book:" << Exchange::orderBookTypeToString(type) << " depth:" << depth << " ns/new-level:" << addTime / static_cast<Nanos>(newLevels) << std::endl;
+            drain(clientResponses, marketUpdates);
+        }
+    }
+
+    return 0;
+}
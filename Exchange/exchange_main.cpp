@@ -28,32 +28,48 @@ void signalHandler(int) {
     exit(EXIT_SUCCESS);
 }
 
-int main(int, char**) {
+// usage: exchange_main [instrument registry file]
+int main(int argc, char** argv) {
     logger = new Logger("exchange_main.log");
     std::signal(SIGINT, signalHandler);
 
+    // books & snapshot state are sized to the instruments listed, without a registry the 8 default tickers are listed
+    const auto instruments = (argc > 1 ? Common::InstrumentRegistry::load(argv[1]) : Common::InstrumentRegistry::defaults());
+
     const int sleep = 100 * 1000;
 
-    Exchange::ClientRequestLFQueue clientRequests(ME_MAX_CLIENT_UPDATES);
+    // tickers are spread over this many matching threads, each one with the books of its tickers
+    const size_t matchingShards = 1;
+    Exchange::ClientRequestRouter clientRequests(matchingShards);
     Exchange::ClientResponseLFQueue clientResponses(ME_MAX_CLIENT_UPDATES);
     Exchange::MEMarketUpdateLFQueue marketUpdates(ME_MAX_MARKET_UPDATES);
+    // PER_LEVEL sends a sweep as one fill & print per level instead of one per resting order it hits
+    const Exchange::FillReporting fillReporting = Exchange::FillReporting::PER_ORDER;
     
     std::string timeStr;
     logger->log("%:% %() % Starting Matching Engine...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&timeStr));
-    matchingEngine = new Exchange::MatchingEngine(&clientRequests, &clientResponses, &marketUpdates);
+    matchingEngine = new Exchange::MatchingEngine(&clientRequests, &clientResponses, &marketUpdates, instruments, Exchange::OrderBookType::LINKED_LIST, fillReporting);
     matchingEngine->start();
 
     const std::string marketPublisherIface = "lo";
-    const std::string snapshotPublishIP = "233.252.14.1", incrementalUpdatesPublishIP = "233.252.14.3";
-    const int snapshotPublishPort = 20000, incrementalUpdatesPublishPort = 20001;
+    const std::string snapshotPublishIP = "233.252.14.1", incrementalUpdatesPublishIP = "233.252.14.3", incrementalUpdatesPublishIPB = "233.252.14.4";
+    const int snapshotPublishPort = 20000, incrementalUpdatesPublishPort = 20001, incrementalUpdatesPublishPortB = 20002;
     logger->log("%:% %() % Starting Market Data Publisher...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&timeStr));
-    marketDataPublisher = new Exchange::MarketDataPublisher(&marketUpdates, marketPublisherIface, snapshotPublishIP, snapshotPublishPort, incrementalUpdatesPublishIP, incrementalUpdatesPublishPort);
+    marketDataPublisher = new Exchange::MarketDataPublisher(&marketUpdates, marketPublisherIface, snapshotPublishIP, snapshotPublishPort, incrementalUpdatesPublishIP, incrementalUpdatesPublishPort,
+        instruments, incrementalUpdatesPublishIPB, incrementalUpdatesPublishPortB);
     marketDataPublisher->start();
 
     const std::string orderGatewayIface = "lo";
     const int orderGatewayPort = 12345;
+    const size_t orderServerIngressThreads = 2;
+    // sequence whatever was read at the end of every read pass, raise the window to trade latency for fairness between sessions
+    const Exchange::FifoSequencerCfg fifoSequencerCfg{0, 0};
+    // IO_URING / IO_URING_SQPOLL move accepts, reads and sends of all sessions onto a ring per thread
+    const Common::TCPBackend orderServerBackend = Common::TCPBackend::EPOLL;
+    // cancel whatever a client has resting when its session drops
+    const bool cancelOnDisconnect = false;
     logger->log("%:% %() % Starting Order Server...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&timeStr));
-    orderServer = new Exchange::OrderServer(&clientRequests, &clientResponses, orderGatewayIface, orderGatewayPort);
+    orderServer = new Exchange::OrderServer(&clientRequests, &clientResponses, orderGatewayIface, orderGatewayPort, orderServerIngressThreads, fifoSequencerCfg, orderServerBackend, cancelOnDisconnect);
     orderServer->start();
     
     while(true) {
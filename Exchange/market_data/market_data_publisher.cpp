@@ -1,12 +1,16 @@
 #include "market_data_publisher.h"
 
 namespace Exchange {
-    MarketDataPublisher::MarketDataPublisher(MEMarketUpdateLFQueue* marketUpdates, const std::string& iface, const std::string& snapshotIp, int snapshotPort, const std::string& incrementalIp, int incrementalPort) : 
+    MarketDataPublisher::MarketDataPublisher(MEMarketUpdateLFQueue* marketUpdates, const std::string& iface, const std::string& snapshotIp, int snapshotPort, const std::string& incrementalIp, int incrementalPort,
+        const InstrumentRegistry& instruments, const std::string& incrementalIpB, int incrementalPortB) : 
     _outgoingMdUpdates(marketUpdates), _snapshotMdUpdates(ME_MAX_MARKET_UPDATES), _run(false),
-    _logger("exchange_market_data_publisher.log"), _incrementalSocket(_logger)
+    _logger("exchange_market_data_publisher.log"), _incrementalSocket(_logger), _incrementalSocketB(_logger),
+    _incrementalWriter(&_incrementalSocket, MDP_INCREMENTAL_CHANNEL, incrementalIpB.empty() ? nullptr : &_incrementalSocketB)
     {
         ASSERT(_incrementalSocket.init(incrementalIp, iface, incrementalPort, false) >= 0, "Unable to create incremental mcast socket. error: " + std::string(std::strerror(errno)));
-        _snapshotSynthesizer = new SnapshotSynthesizer(&_snapshotMdUpdates, iface, snapshotIp, snapshotPort);
+        if (!incrementalIpB.empty())
+            ASSERT(_incrementalSocketB.init(incrementalIpB, iface, incrementalPortB, false) >= 0, "Unable to create incremental B mcast socket. error: " + std::string(std::strerror(errno)));
+        _snapshotSynthesizer = new SnapshotSynthesizer(&_snapshotMdUpdates, iface, snapshotIp, snapshotPort, instruments);
     }
 
     MarketDataPublisher::~MarketDataPublisher() {
@@ -34,9 +38,8 @@ namespace Exchange {
             for (auto marketUpdate = _outgoingMdUpdates->getNextRead(); _outgoingMdUpdates->size() && marketUpdate; marketUpdate = _outgoingMdUpdates->getNextRead()) {
                 _logger.log("%:% %() % Sending seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), _nextIncSeqNum, marketUpdate->toString().c_str());
 
-                // send outgoing market updates
-                _incrementalSocket.send(&_nextIncSeqNum, sizeof(_nextIncSeqNum));
-                _incrementalSocket.send(marketUpdate, sizeof(MEMarketUpdate));
+                // queue outgoing market update
+                _incrementalWriter.add(MDPMarketUpdate{_nextIncSeqNum, *marketUpdate});
                 _outgoingMdUpdates->updateReadIndex();
 
                 // send update to snapshotSynthesizer
@@ -48,7 +51,8 @@ namespace Exchange {
                 _nextIncSeqNum++;
             }
 
-            _incrementalSocket.sendAndRecv();
+            // everything the matching engine published since the last pass goes out now, in full packets
+            _incrementalWriter.flush();
         }
     }
 
@@ -3,11 +3,14 @@
 #include <functional>
 #include "types.h"
 #include "snapshot_synthesizer.h"
+#include "mdp_packet_writer.h"
 
 namespace Exchange {
     class MarketDataPublisher {
     public:
-        MarketDataPublisher(MEMarketUpdateLFQueue* marketUpdates, const std::string& iface, const std::string& snapshotIp, int snapshotPort, const std::string& incrementalIp, int incrementalPort);
+        // with incrementalIpB set every incremental packet is also published on that group (B line)
+        MarketDataPublisher(MEMarketUpdateLFQueue* marketUpdates, const std::string& iface, const std::string& snapshotIp, int snapshotPort, const std::string& incrementalIp, int incrementalPort,
+            const InstrumentRegistry& instruments, const std::string& incrementalIpB = "", int incrementalPortB = 0);
         ~MarketDataPublisher();
 
         MarketDataPublisher() = delete;
@@ -31,6 +34,10 @@ namespace Exchange {
         Logger _logger;
         // socket for multicasting the market updates
         Common::McastSocket _incrementalSocket;
+        // socket for the B copy of the market updates, unused without a B line
+        Common::McastSocket _incrementalSocketB;
+        // packs the updates of a matching engine batch into as few packets as fit the mtu
+        MDPPacketWriter _incrementalWriter;
         SnapshotSynthesizer* _snapshotSynthesizer = nullptr;
     };
 }
\ No newline at end of file
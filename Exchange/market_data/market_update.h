@@ -3,20 +3,22 @@
 #include <sstream>
 #include "types.h"
 #include "lf_queue.h"
+#include "time_utils.h"
+#include "wire_codec.h"
 
 using namespace Common;
 
 namespace Exchange {
-#pragma pack(push, 1)
     enum class MarketUpdateType : uint8_t {
         INVALID = 0,
         CLEAR = 1, // instructs market participants to clear their order book
         ADD = 2,
         MODIFY = 3,
-        CANCEL = 4,
+        CANCEL = 4, // order is gone from the book, carries qty 0 and the price & priority it rested at
         TRADE = 5, 
         SNAPSHOT_START = 6, // signifies that a snapshot message is starting
         SNAPSHOT_END = 7,  // signifies that a snapshot update has been delivered
+        LEVEL_CLEAR = 8, // every order resting at price on side is gone, sent for a level a sweep took whole with FillReporting::PER_LEVEL
     };
 
     inline std::string marketUpdateTypeToString(MarketUpdateType type) noexcept {
@@ -29,6 +31,8 @@ namespace Exchange {
                 return "CANCEL";
             case MarketUpdateType::TRADE:
                 return "TRADE";
+            case MarketUpdateType::LEVEL_CLEAR:
+                return "LEVEL_CLEAR";
             case MarketUpdateType::INVALID:
                 return "INVALID";
         }
@@ -66,22 +70,94 @@ namespace Exchange {
     // to the market participant
     struct MDPMarketUpdate {
         // will be used by the client to identify if any packet was dropped
-        size_t seqNumber = 0;
+        SeqNum seqNumber = 0;
         MEMarketUpdate meMarketUpdate;
+        // SNAPSHOT_START & SNAPSHOT_END only: seqNumber of the last incremental update the snapshot includes
+        SeqNum incSeqNumber = 0;
 
         auto toString() const {
             std::stringstream ss;
             ss << "MDPMarketUpdate"
             << " ["
-            << " seq:" << seqNumber
-            << " " << meMarketUpdate.toString()
+            << " seq:" << seqNumber;
+            if (meMarketUpdate.type == MarketUpdateType::SNAPSHOT_START || meMarketUpdate.type == MarketUpdateType::SNAPSHOT_END)
+                ss << " inc-seq:" << incSeqNumber;
+            ss << " " << meMarketUpdate.toString()
             << "]";
             return ss.str();
         }
     };
-    
 
-#pragma pack(pop)
+    // header in front of every market data packet, numUpdates MDPMarketUpdates with consecutive seqNumbers follow it
+    // lets consumers spot a gap or a duplicate from the header alone, before looking at the updates
+    struct MDPPacketHeader {
+        uint16_t channel = 0;
+        SeqNum firstSeqNumber = 0;
+        uint16_t numUpdates = 0;
+        uint16_t updateLength = 0; // bytes each update takes on the wire, updates of a newer version may be longer
+        Nanos sendTime = 0; // publisher's clock when the packet was closed
+
+        auto toString() const {
+            std::stringstream ss;
+            ss << "MDPPacketHeader"
+            << " ["
+            << " channel:" << channel
+            << " first-seq:" << firstSeqNumber
+            << " updates:" << numUpdates
+            << " update-length:" << updateLength
+            << " send-time:" << sendTime
+            << "]";
+            return ss.str();
+        }
+    };
+
+    // layouts of a market data packet on the wire, see wire_codec.h: the header as a message followed by numUpdates
+    // blocks of updateLength bytes, the seqNumber of an update is not sent, it follows from its place in the packet
+    using MDPPacketHeaderCodec = WireCodec<MDPPacketHeader, 3, 1,
+        WireField<uint16_t, &MDPPacketHeader::channel>,
+        WireField<uint64_t, &MDPPacketHeader::firstSeqNumber>,
+        WireField<uint16_t, &MDPPacketHeader::numUpdates>,
+        WireField<uint16_t, &MDPPacketHeader::updateLength>,
+        WireField<int64_t, &MDPPacketHeader::sendTime>>;
+    // the 64 bit id field of an update: the order id, SNAPSHOT_START & SNAPSHOT_END have none and carry their
+    // incSeqNumber there instead, at full width whatever the width of OrderId, it follows type so decode knows which
+    struct MDPUpdateIdField {
+        static constexpr size_t Size = sizeof(uint64_t);
+
+        static auto isSnapshotBound(MarketUpdateType type) noexcept -> bool {
+            return type == MarketUpdateType::SNAPSHOT_START || type == MarketUpdateType::SNAPSHOT_END;
+        }
+
+        static auto encode(const MDPMarketUpdate& msg, char* out) noexcept -> void {
+            const auto wire = isSnapshotBound(msg.meMarketUpdate.type) ? toWire<uint64_t>(msg.incSeqNumber) : toWire<uint64_t>(msg.meMarketUpdate.orderId);
+            memcpy(out, &wire, Size);
+        }
+
+        static auto decode(const char* in, MDPMarketUpdate& msg) noexcept -> void {
+            uint64_t wire;
+            memcpy(&wire, in, Size);
+            if (isSnapshotBound(msg.meMarketUpdate.type))
+                msg.incSeqNumber = fromWire<SeqNum>(wire);
+            else
+                msg.meMarketUpdate.orderId = fromWire<OrderId>(wire);
+        }
+    };
+
+    using MDPMarketUpdateCodec = WireCodec<MDPMarketUpdate, 4, 1,
+        WireField<uint8_t, &MDPMarketUpdate::meMarketUpdate, &MEMarketUpdate::type>,
+        MDPUpdateIdField,
+        WireField<uint16_t, &MDPMarketUpdate::meMarketUpdate, &MEMarketUpdate::tickerId>,
+        WireField<int8_t, &MDPMarketUpdate::meMarketUpdate, &MEMarketUpdate::side>,
+        WireField<int32_t, &MDPMarketUpdate::meMarketUpdate, &MEMarketUpdate::price>,
+        WireField<uint32_t, &MDPMarketUpdate::meMarketUpdate, &MEMarketUpdate::qty>,
+        WireField<uint32_t, &MDPMarketUpdate::meMarketUpdate, &MEMarketUpdate::priority>>;
+
+    // streams the packets are published on
+    constexpr uint16_t MDP_INCREMENTAL_CHANNEL = 1;
+    constexpr uint16_t MDP_SNAPSHOT_CHANNEL = 2;
+    // largest packet that goes out without ip fragmentation: a 1500 byte ethernet mtu minus the ip and udp headers
+    constexpr size_t MDP_MAX_PACKET_SIZE = 1500 - 20 - 8;
+    constexpr size_t MDP_MAX_UPDATES_PER_PACKET = (MDP_MAX_PACKET_SIZE - MDPPacketHeaderCodec::MessageLength) / MDPMarketUpdateCodec::BlockLength;
 
     // queue used for communicatoin from matching engine to market data publisher
     typedef LFQueue<MEMarketUpdate> MEMarketUpdateLFQueue;
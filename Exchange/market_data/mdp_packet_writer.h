@@ -0,0 +1,89 @@
+#pragma once
+
+#include "macros.h"
+#include "time_utils.h"
+#include "mcast_socket.h"
+#include "market_update.h"
+
+namespace Exchange {
+    // packs MDPMarketUpdates into packets of at most MDP_MAX_PACKET_SIZE bytes, each starting with an MDPPacketHeader
+    // (encoded with the wire codecs of market_update.h)
+    // packets are queued on the socket as separate datagrams and go out together on flush()
+    // with a mirror socket every packet is also sent on a second line (A/B feeds), the B copy right after the A one
+    class MDPPacketWriter {
+    public:
+        MDPPacketWriter(Common::McastSocket* socket, uint16_t channel, Common::McastSocket* mirror = nullptr) : _socket(socket), _mirror(mirror), _channel(channel) {}
+
+        MDPPacketWriter() = delete;
+        MDPPacketWriter(const MDPPacketWriter&) = delete;
+        MDPPacketWriter(const MDPPacketWriter&&) = delete;
+        MDPPacketWriter& operator=(const MDPPacketWriter&) = delete;
+        MDPPacketWriter& operator=(const MDPPacketWriter&&) = delete;
+
+        // appends update to the open packet, starting a new one when it is full, updates of a packet have to carry
+        // consecutive seqNumbers
+        auto add(const MDPMarketUpdate& update) noexcept -> void {
+            if (UNLIKELY(_numUpdates == MDP_MAX_UPDATES_PER_PACKET))
+                closePacket();
+
+            if (!_numUpdates) {
+                _header = {_channel, update.seqNumber, 0, static_cast<uint16_t>(MDPMarketUpdateCodec::BlockLength), 0};
+                char header[MDPPacketHeaderCodec::MessageLength];
+                MDPPacketHeaderCodec::encode(_header, header);
+                _headerOffset = _socket->next_send_valid_index;
+                _socket->send(header, sizeof(header));
+                if (_mirror) {
+                    _mirrorHeaderOffset = _mirror->next_send_valid_index;
+                    _mirror->send(header, sizeof(header));
+                }
+            }
+
+            if (UNLIKELY(update.seqNumber != _header.firstSeqNumber + _numUpdates))
+                FATAL("Update out of sequence " + update.toString() + " in packet " + _header.toString());
+            char encoded[MDPMarketUpdateCodec::BlockLength];
+            MDPMarketUpdateCodec::encodeBlock(update, encoded);
+            _socket->send(encoded, sizeof(encoded));
+            if (_mirror)
+                _mirror->send(encoded, sizeof(encoded));
+            _numUpdates++;
+        }
+
+        // closes the open packet and sends everything queued
+        auto flush() noexcept -> void {
+            closePacket();
+            _socket->sendAndRecv();
+            if (_mirror)
+                _mirror->sendAndRecv();
+        }
+
+    private:
+        // fills in the header of the open packet and ends its datagram
+        auto closePacket() noexcept -> void {
+            if (!_numUpdates)
+                return;
+
+            _header.numUpdates = static_cast<uint16_t>(_numUpdates);
+            _header.sendTime = Common::getCurrentNanos();
+            closePacket(_socket, _headerOffset);
+            if (_mirror)
+                closePacket(_mirror, _mirrorHeaderOffset);
+            _numUpdates = 0;
+        }
+
+        // as above for the copy of the packet queued on socket, the header is encoded again over the one sent
+        auto closePacket(Common::McastSocket* socket, size_t headerOffset) noexcept -> void {
+            MDPPacketHeaderCodec::encode(_header, socket->send_buffer.data() + headerOffset);
+            socket->endDatagram();
+        }
+
+        Common::McastSocket* _socket = nullptr;
+        Common::McastSocket* _mirror = nullptr;
+        const uint16_t _channel;
+        // header of the open packet
+        MDPPacketHeader _header;
+        // where the header of the open packet starts in the socket's & the mirror's send buffer
+        size_t _headerOffset = 0;
+        size_t _mirrorHeaderOffset = 0;
+        size_t _numUpdates = 0;
+    };
+}
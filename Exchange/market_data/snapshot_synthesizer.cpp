@@ -1,14 +1,37 @@
 #include "snapshot_synthesizer.h"
 
 namespace Exchange {
-    SnapshotSynthesizer::SnapshotSynthesizer(MDPMarketUpdateLFQueue* marketUpdates, const std::string& iface, const std::string& snapshotIp, const int snapshotPort) 
-    : _snapshotMdUpdates(marketUpdates), _logger("exchange_snapshot_synthesizer.log"), _snapshotSocket(_logger), _orderPool(ME_MAX_ORDER_IDS)
+    // the pool holds the live orders of all instruments
+    static auto totalOrders(const InstrumentRegistry& instruments) noexcept -> size_t {
+        size_t orders = 0;
+        for (const auto& instrument : instruments)
+            orders += instrument.maxOrders;
+        return orders;
+    }
+
+    SnapshotSynthesizer::SnapshotSynthesizer(MDPMarketUpdateLFQueue* marketUpdates, const std::string& iface, const std::string& snapshotIp, const int snapshotPort, const InstrumentRegistry& instruments) 
+    : _snapshotMdUpdates(marketUpdates), _logger("exchange_snapshot_synthesizer.log"), _snapshotSocket(_logger), _snapshotWriter(&_snapshotSocket, MDP_SNAPSHOT_CHANNEL), _instruments(instruments),
+      _orderPool(totalOrders(instruments))
     { 
+        _tickerOrders.reserve(instruments.size());
+        _tickerSlotOrders.reserve(instruments.size());
+        size_t maxOrders = 0;
+        for (const auto& instrument : instruments) {
+            _tickerOrders.push_back(new OrderIdIndex<SnapshotOrder>(instrument.maxOrders));
+            maxOrders = std::max(maxOrders, instrument.maxOrders);
+            _tickerSlotOrders.emplace_back(instrument.maxPriceLevels, nullptr);
+        }
+        _snapshotOrders.reserve(maxOrders);
+
         ASSERT(_snapshotSocket.init(snapshotIp, iface, snapshotPort, false) >= 0, "Unable to create mcast socket. Error: " + std::string(std::strerror(errno)));
     }
 
     SnapshotSynthesizer::~SnapshotSynthesizer() {
         stop();
+        for (auto& orders : _tickerOrders) {
+            delete orders;
+            orders = nullptr;
+        }
     }
 
     auto SnapshotSynthesizer::start() noexcept -> void {
@@ -22,33 +45,56 @@ namespace Exchange {
 
     auto SnapshotSynthesizer::addToSnapshot(const MDPMarketUpdate* marketUpdate) {
         const auto& meMarketUpdate = marketUpdate->meMarketUpdate;
-        auto *orders = &_tickerOrders.at(meMarketUpdate.tickerId);
+        auto orders = _tickerOrders.at(meMarketUpdate.tickerId);
 
         switch (meMarketUpdate.type)
         {
         case MarketUpdateType::ADD: {
-            auto order = orders->at(meMarketUpdate.orderId);
-            ASSERT(order == nullptr, "Received: " + meMarketUpdate.toString() + " but order already exists: " + (order? order->toString() : ""));
-            orders->at(meMarketUpdate.orderId) = _orderPool.allocate(meMarketUpdate);
+            auto order = orders->find(meMarketUpdate.orderId);
+            ASSERT(order == nullptr, "Received: " + meMarketUpdate.toString() + " but order already exists: " + (order? order->update.toString() : ""));
+            order = _orderPool.allocate(meMarketUpdate);
+            orders->insert(meMarketUpdate.orderId, order);
+            linkToSlot(order);
         }
             break;
         case MarketUpdateType::MODIFY: {
-            auto order = orders->at(meMarketUpdate.orderId);
+            auto order = orders->find(meMarketUpdate.orderId);
             ASSERT(order != nullptr, "Received: " + meMarketUpdate.toString() + " but order does not exist.");
-            ASSERT(order->orderId == meMarketUpdate.orderId, "Expecting existing order to match new one.");
-            ASSERT(order->side == meMarketUpdate.side, "Expecting existing order to match new one.");
-            order->qty = meMarketUpdate.qty;
-            order->price = meMarketUpdate.price;
+            ASSERT(order->update.orderId == meMarketUpdate.orderId, "Expecting existing order to match new one.");
+            ASSERT(order->update.side == meMarketUpdate.side, "Expecting existing order to match new one.");
+            // an amend to another price moves it to the slot of that price
+            const bool moved = (order->update.price != meMarketUpdate.price);
+            if (moved)
+                unlinkFromSlot(order);
+            order->update.qty = meMarketUpdate.qty;
+            order->update.price = meMarketUpdate.price;
+            order->update.priority = meMarketUpdate.priority;
+            if (moved)
+                linkToSlot(order);
         }
             break;
         case MarketUpdateType::CANCEL: {
-            auto order = orders->at(meMarketUpdate.orderId);
+            auto order = orders->find(meMarketUpdate.orderId);
             ASSERT(order != nullptr, "Received: " + meMarketUpdate.toString() + " but order does not exist.");
-            ASSERT(order->orderId == meMarketUpdate.orderId, "Expecting existing order to match new one.");
-            ASSERT(order->side == meMarketUpdate.side, "Expecting existing order to match new one.");
+            ASSERT(order->update.orderId == meMarketUpdate.orderId, "Expecting existing order to match new one.");
+            ASSERT(order->update.side == meMarketUpdate.side, "Expecting existing order to match new one.");
 
+            unlinkFromSlot(order);
             _orderPool.deallocate(order);
-            orders->at(meMarketUpdate.orderId) = nullptr;
+            orders->erase(meMarketUpdate.orderId);
+        }
+            break;
+        case MarketUpdateType::LEVEL_CLEAR: {
+            const auto slot = _instruments.at(meMarketUpdate.tickerId).priceToIndex(meMarketUpdate.price);
+            for (auto order = _tickerSlotOrders.at(meMarketUpdate.tickerId).at(slot); order;) {
+                const auto next = order->nextInSlot;
+                if (order->update.side == meMarketUpdate.side && order->update.price == meMarketUpdate.price) {
+                    unlinkFromSlot(order);
+                    orders->erase(order->update.orderId);
+                    _orderPool.deallocate(order);
+                }
+                order = next;
+            }
         }
             break;
         case MarketUpdateType::SNAPSHOT_START:
@@ -63,16 +109,33 @@ namespace Exchange {
         _lastIncSeqNum = marketUpdate->seqNumber;
     }
 
+    auto SnapshotSynthesizer::linkToSlot(SnapshotOrder* order) noexcept -> void {
+        auto& head = _tickerSlotOrders.at(order->update.tickerId).at(_instruments.at(order->update.tickerId).priceToIndex(order->update.price));
+        order->prevInSlot = nullptr;
+        order->nextInSlot = head;
+        if (head)
+            head->prevInSlot = order;
+        head = order;
+    }
+
+    auto SnapshotSynthesizer::unlinkFromSlot(SnapshotOrder* order) noexcept -> void {
+        if (order->prevInSlot)
+            order->prevInSlot->nextInSlot = order->nextInSlot;
+        else
+            _tickerSlotOrders.at(order->update.tickerId).at(_instruments.at(order->update.tickerId).priceToIndex(order->update.price)) = order->nextInSlot;
+        if (order->nextInSlot)
+            order->nextInSlot->prevInSlot = order->prevInSlot;
+    }
+
     auto SnapshotSynthesizer::publishSnapshot() noexcept -> void {
         size_t snapshotSize = 0;
-        const MDPMarketUpdate startMarketUpdate{snapshotSize++, {MarketUpdateType::SNAPSHOT_START, _lastIncSeqNum}};
+        const MDPMarketUpdate startMarketUpdate{snapshotSize++, {MarketUpdateType::SNAPSHOT_START}, _lastIncSeqNum};
 
         // send snapshot initialization
         _logger.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, getCurrentTimeStr(&_timeStr), startMarketUpdate.toString()); 
-        _snapshotSocket.send(&startMarketUpdate, sizeof(MDPMarketUpdate));
+        _snapshotWriter.add(startMarketUpdate);
 
         for (size_t tickerId = 0; tickerId < _tickerOrders.size(); tickerId++) {
-            const auto& orders = _tickerOrders.at(tickerId);
             MEMarketUpdate meMarketUpdate;
             meMarketUpdate.type = MarketUpdateType::CLEAR;
             meMarketUpdate.tickerId = tickerId;
@@ -80,24 +143,31 @@ namespace Exchange {
             // send clear message
             const MDPMarketUpdate clearMarketUpdate{snapshotSize++, meMarketUpdate};
             _logger.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, getCurrentTimeStr(&_timeStr), clearMarketUpdate.toString());
-            _snapshotSocket.send(&clearMarketUpdate, sizeof(MDPMarketUpdate));
-
-            // send all orders of each ticker that are live
-            for (const auto order : orders) {
-                if (order) {
-                    const MDPMarketUpdate marketUpdate{snapshotSize++, *order};
-                    _logger.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, getCurrentTimeStr(&_timeStr), marketUpdate.toString());
-                    _snapshotSocket.send(&marketUpdate, sizeof(MDPMarketUpdate));
-                    _snapshotSocket.sendAndRecv();
-                }
+            _snapshotWriter.add(clearMarketUpdate);
+
+            // send all live orders of each ticker in id order, the same snapshot whatever the layout of the index
+            _snapshotOrders.clear();
+            _tickerOrders.at(tickerId)->forEach([this](const SnapshotOrder* order) {
+                _snapshotOrders.push_back(order);
+            });
+            std::sort(_snapshotOrders.begin(), _snapshotOrders.end(), [](const SnapshotOrder* a, const SnapshotOrder* b) {
+                return a->update.orderId < b->update.orderId;
+            });
+            for (const auto order : _snapshotOrders) {
+                const MDPMarketUpdate marketUpdate{snapshotSize++, order->update};
+                _logger.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, getCurrentTimeStr(&_timeStr), marketUpdate.toString());
+                _snapshotWriter.add(marketUpdate);
             }
+
+            // a ticker at a time, so a large book does not overrun the consumers' receive buffers in one burst
+            _snapshotWriter.flush();
         }
 
         // send message designating the end of snapshot message
-        const MDPMarketUpdate endMarketUpdate{snapshotSize++, {MarketUpdateType::SNAPSHOT_END, _lastIncSeqNum}};
+        const MDPMarketUpdate endMarketUpdate{snapshotSize++, {MarketUpdateType::SNAPSHOT_END}, _lastIncSeqNum};
         _logger.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, getCurrentTimeStr(&_timeStr), endMarketUpdate.toString());
-        _snapshotSocket.send(&endMarketUpdate, sizeof(MDPMarketUpdate));
-        _snapshotSocket.sendAndRecv();
+        _snapshotWriter.add(endMarketUpdate);
+        _snapshotWriter.flush();
     
         _logger.log("%:% %() % Published snapshot of % orders.\n", __FILE__, __LINE__, __FUNCTION__, getCurrentTimeStr(&_timeStr), snapshotSize - 1);
     }
@@ -1,14 +1,18 @@
 #pragma once
 
+#include <algorithm>
 #include <cstring>
 #include "types.h"
+#include "instrument_registry.h"
 #include "thread_utils.h"
 #include "lf_queue.h"
 #include "macros.h"
 #include "mcast_socket.h"
 #include "mem_pool.h"
+#include "order_id_index.h"
 #include "logging.h"
 #include "market_update.h"
+#include "mdp_packet_writer.h"
 #include "me_order.h"
 
 using namespace Common;
@@ -16,7 +20,7 @@ using namespace Common;
 namespace Exchange {
     class SnapshotSynthesizer {
     public:
-        SnapshotSynthesizer(MDPMarketUpdateLFQueue* marketUpdates, const std::string& iface, const std::string& snapshotIp, const int snapshotPort);
+        SnapshotSynthesizer(MDPMarketUpdateLFQueue* marketUpdates, const std::string& iface, const std::string& snapshotIp, const int snapshotPort, const InstrumentRegistry& instruments);
         ~SnapshotSynthesizer();
 
         SnapshotSynthesizer() = delete;
@@ -32,9 +36,21 @@ namespace Exchange {
         auto stop() noexcept -> void;
 
     private:
+        // live order of the snapshot, linked with the other orders in its price level slot so a LEVEL_CLEAR finds the
+        // ones at its price without going through every order of the ticker
+        struct SnapshotOrder {
+            MEMarketUpdate update;
+            SnapshotOrder* prevInSlot = nullptr;
+            SnapshotOrder* nextInSlot = nullptr;
+        };
+
         auto run() noexcept -> void;
         // method for adding marketUpdate to snapshot
         auto addToSnapshot(const MDPMarketUpdate* marketUpdate);
+        // function for adding order to the list of its price level slot
+        auto linkToSlot(SnapshotOrder* order) noexcept -> void;
+        // function for taking order out of the list of its price level slot
+        auto unlinkFromSlot(SnapshotOrder* order) noexcept -> void;
 
         // queue that receives updates from MarketDataPublisher
         MDPMarketUpdateLFQueue* _snapshotMdUpdates = nullptr;
@@ -42,12 +58,18 @@ namespace Exchange {
         volatile bool _run = false;
         std::string _timeStr;
         McastSocket _snapshotSocket;
-        // contains orders for each ticker
-        std::array<std::array<MEMarketUpdate*, ME_MAX_ORDER_IDS>, ME_MAX_TICKERS> _tickerOrders;
+        MDPPacketWriter _snapshotWriter;
+        // live orders of each ticker by market order id, sized to the orders of the instrument
+        std::vector<OrderIdIndex<SnapshotOrder>*> _tickerOrders;
+        // orders of the ticker being published, sorted by id
+        std::vector<const SnapshotOrder*> _snapshotOrders;
+        // orders of each ticker by price level slot (InstrumentCfg::priceToIndex), prices sharing a slot share its list
+        std::vector<std::vector<SnapshotOrder*>> _tickerSlotOrders;
+        const InstrumentRegistry _instruments;
         // seq num of last update received
-        size_t _lastIncSeqNum = 0;
+        SeqNum _lastIncSeqNum = 0;
         // time of when last snapshot was sent
         Nanos _lastSnapshotTime = 0;
-        MemPool<MEMarketUpdate> _orderPool;
+        MemPool<SnapshotOrder> _orderPool;
     };
 }
\ No newline at end of file
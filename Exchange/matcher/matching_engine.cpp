@@ -1,12 +1,18 @@
 #include "matching_engine.h"
 
 namespace Exchange {
-    MatchingEngine::MatchingEngine(ClientRequestLFQueue* clientRequests, ClientResponseLFQueue* clientResponses, MEMarketUpdateLFQueue* marketUpdates) :
-    _incomingRequests(clientRequests), _outgoingOgwResponses(clientResponses), _outgoingMDUpdates(marketUpdates),
-    _logger("exchange_matching_engine.log") {
-        for (size_t i = 0; i < _tickerOrderBook.size(); i++)
-        {
-            _tickerOrderBook[i] = new MEOrderBook(i, &_logger, this);
+    MatchingEngine::MatchingEngine(ClientRequestRouter* clientRequests, ClientResponseLFQueue* clientResponses, MEMarketUpdateLFQueue* marketUpdates, const InstrumentRegistry& instruments, OrderBookType bookType,
+                                   FillReporting fillReporting) :
+    _logger("exchange_matching_engine.log"), _responseMerger(clientResponses), _updateMerger(marketUpdates) {
+        const auto numShards = clientRequests->numShards();
+        _logger.log("%:% %() % Starting % matching shards\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), numShards);
+
+        // with a single shard it sends straight to the order server & publisher
+        for (size_t i = 0; i < numShards; i++) {
+            auto shard = new MatchingShard(i, clientRequests, numShards == 1 ? clientResponses : nullptr, numShards == 1 ? marketUpdates : nullptr, instruments, bookType, fillReporting);
+            if (numShards > 1)
+                shard->addTo(&_responseMerger, &_updateMerger);
+            _shards.push_back(shard);
         }
     }
 
@@ -14,66 +20,32 @@ namespace Exchange {
         stop();
         using namespace std::literals::chrono_literals;
         std::this_thread::sleep_for(1s);
-        _incomingRequests = nullptr;
-        _outgoingOgwResponses = nullptr;
-        _outgoingMDUpdates = nullptr;
-        for (auto &orderBook : _tickerOrderBook) {
-            delete orderBook;
-            orderBook = nullptr;
+        for (auto &shard : _shards) {
+            delete shard;
+            shard = nullptr;
         }
     }
 
     auto MatchingEngine::stop() noexcept -> void {
+        for (auto shard : _shards)
+            shard->stop();
         _run = false;
     }
 
-    auto MatchingEngine::run() noexcept -> void {
-        _logger.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr));
-
-        while(_run) {
-            const auto clientRequest = _incomingRequests->getNextRead();
-            if (LIKELY(clientRequest)) {
-                _logger.log("%:% %() % Processing %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), clientRequest->toString());
-                processClientRequest(clientRequest);
-                _incomingRequests->updateReadIndex();
-            }
-        }
-    }
-
-    auto MatchingEngine::processClientRequest(const MEClientRequest* clientRequest) noexcept -> void {
-        auto orderBook = _tickerOrderBook[clientRequest->tickerId];
-
-        switch (clientRequest->type)
-        {
-        case ClientRequestType::NEW:
-            orderBook->add(clientRequest->clientId, clientRequest->orderId, clientRequest->tickerId, clientRequest->side, clientRequest->price, clientRequest->qty);
-            break;
-        case ClientRequestType::CANCEL:
-            orderBook->cancel(clientRequest->clientId, clientRequest->orderId, clientRequest->tickerId);
-        default:
-            FATAL("Received invalid client-request type: " + clientRequestTypeToString(clientRequest->type));
-            break;
-        }
-    }
-
     auto MatchingEngine::start() noexcept -> void {
         _run = true;
-        ASSERT(Common::createAndStartThread(-1, "Exchange/MatchingEngine", [this]() { run(); }) != nullptr, "Failed to start MatchingEngine thread.");
+        for (auto shard : _shards)
+            shard->start();
+        if (_shards.size() > 1)
+            ASSERT(Common::createAndStartThread(-1, "Exchange/MatchingEngine/Merger", [this]() { runMerger(); }) != nullptr, "Failed to start MatchingEngine merger thread.");
     }
 
+    auto MatchingEngine::runMerger() noexcept -> void {
+        _logger.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr));
 
-    auto MatchingEngine::sendClientResponse(const MEClientResponse* clientResponse) noexcept -> void {
-        _logger.log("%:% %() % Sending %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), clientResponse->toString());
-        auto nextWrite = _outgoingOgwResponses->getNextWriteTo();
-        *nextWrite = std::move(*clientResponse);
-        _outgoingOgwResponses->updateWriteIndex();
-    }
-
-    auto MatchingEngine::sendMarketUpdate(const MEMarketUpdate* marketUpdate) noexcept -> void {
-        _logger.log("%:% %() % Sending %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), marketUpdate->toString());
-        auto nextWrite = _outgoingMDUpdates->getNextWriteTo();
-        *nextWrite = *marketUpdate;
-        _outgoingMDUpdates->updateWriteIndex();     
+        while (_run) {
+            _responseMerger.mergeAndPublish();
+            _updateMerger.mergeAndPublish();
+        }
     }
-    
 }
@@ -4,18 +4,23 @@
 #include "thread_utils.h"
 #include "macros.h"
 #include "logging.h"
-#include "client_request.h"
+#include "client_request_router.h"
 #include "client_response.h"
 #include "market_update.h"
 
-#include "me_order_book.h"
+#include "matching_shard.h"
+#include "shard_merger.h"
 
 using namespace Common;
 
 namespace Exchange {
     class MatchingEngine final {
         public:
-            MatchingEngine(ClientRequestLFQueue* clientRequests, ClientResponseLFQueue* clientResponses, MEMarketUpdateLFQueue* marketUpdates);
+            // a MatchingShard is started for every shard of clientRequests, each one owning the order books (of bookType,
+            // sized to the registry's limits & reporting fills as fillReporting) of its tickers, with more than one shard a
+            // merger thread puts what they send back into request order before it reaches clientResponses & marketUpdates
+            MatchingEngine(ClientRequestRouter* clientRequests, ClientResponseLFQueue* clientResponses, MEMarketUpdateLFQueue* marketUpdates, const InstrumentRegistry& instruments,
+                           OrderBookType bookType = OrderBookType::LINKED_LIST, FillReporting fillReporting = FillReporting::PER_ORDER);
             ~MatchingEngine();
             MatchingEngine() = delete;
             MatchingEngine(const MatchingEngine& ) = delete;
@@ -26,23 +31,16 @@ namespace Exchange {
             auto start() noexcept -> void;
             auto stop() noexcept -> void;
 
-            auto sendClientResponse(const MEClientResponse* clientResponse) noexcept -> void;
-            auto sendMarketUpdate(const MEMarketUpdate* marketUpdate) noexcept -> void;
-
         private:
-            auto processClientRequest(const MEClientRequest* clientRequest) noexcept -> void;
-            auto run() noexcept -> void;
-
+            // merges the responses & updates of all shards into the outgoing queues
+            auto runMerger() noexcept -> void;
 
-            ClientRequestLFQueue* _incomingRequests = nullptr;
-            // outgoing order gateway responses
-            ClientResponseLFQueue* _outgoingOgwResponses = nullptr;
-            // outgoing market data updates
-            MEMarketUpdateLFQueue* _outgoingMDUpdates = nullptr;
             volatile bool _run = false;
             std::string _timeStr;
             Logger _logger;
-            OrderBookHashMap _tickerOrderBook; 
+            std::vector<MatchingShard*> _shards;
+            ShardMerger<MEClientResponse> _responseMerger;
+            ShardMerger<MEMarketUpdate> _updateMerger;
     };
 
 }
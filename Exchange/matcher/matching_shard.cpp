@@ -0,0 +1,162 @@
+#include "matching_shard.h"
+
+namespace Exchange {
+    MatchingShard::MatchingShard(size_t index, ClientRequestRouter* router, ClientResponseLFQueue* clientResponses, MEMarketUpdateLFQueue* marketUpdates, const InstrumentRegistry& instruments,
+                                 OrderBookType bookType, FillReporting fillReporting) :
+    _index(index), _router(router), _incomingRequests(router->shardRequests(index)), _outgoingOgwResponses(clientResponses), _outgoingMDUpdates(marketUpdates),
+    _logger("exchange_matching_engine" + std::to_string(index) + ".log") {
+        if (!clientResponses) {
+            _shardResponses = new ShardClientResponseLFQueue(ME_MAX_CLIENT_UPDATES);
+            _shardUpdates = new ShardMarketUpdateLFQueue(ME_MAX_MARKET_UPDATES);
+        }
+
+        _tickerOrderBook.resize(instruments.size(), nullptr);
+        for (const auto& instrument : instruments)
+        {
+            if (router->shardOf(instrument.tickerId) != index)
+                continue;
+            _logger.log("%:% %() % Listing % book:% fills:% shard:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), instrument.toString(), orderBookTypeToString(bookType),
+                        fillReportingToString(fillReporting), index);
+            _tickerOrderBook[instrument.tickerId] = new MEOrderBook(instrument, &_logger, this, bookType, fillReporting);
+        }
+    }
+
+    MatchingShard::~MatchingShard() {
+        stop();
+        using namespace std::literals::chrono_literals;
+        std::this_thread::sleep_for(1s);
+        _incomingRequests = nullptr;
+        _outgoingOgwResponses = nullptr;
+        _outgoingMDUpdates = nullptr;
+        for (auto &orderBook : _tickerOrderBook) {
+            delete orderBook;
+            orderBook = nullptr;
+        }
+        delete _shardResponses;
+        delete _shardUpdates;
+        _shardResponses = nullptr;
+        _shardUpdates = nullptr;
+    }
+
+    auto MatchingShard::stop() noexcept -> void {
+        _run = false;
+    }
+
+    auto MatchingShard::start() noexcept -> void {
+        _run = true;
+        ASSERT(Common::createAndStartThread(-1, "Exchange/MatchingEngine/Shard" + std::to_string(_index), [this]() { run(); }) != nullptr, "Failed to start MatchingShard thread.");
+    }
+
+    auto MatchingShard::addTo(ShardMerger<MEClientResponse>* responseMerger, ShardMerger<MEMarketUpdate>* updateMerger) noexcept -> void {
+        ASSERT(_shardResponses, "MatchingShard " + std::to_string(_index) + " sends straight to the order server & publisher.");
+        responseMerger->addInput(_shardResponses, &_watermark);
+        updateMerger->addInput(_shardUpdates, &_watermark);
+    }
+
+    auto MatchingShard::run() noexcept -> void {
+        _logger.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr));
+
+        while(_run) {
+            // read before looking at the queue, if it is empty every request for us sequenced before routed is done
+            const auto routed = (_shardResponses ? _router->routed() : 0);
+            const auto clientRequest = _incomingRequests->getNextRead();
+            auto watermark = routed;
+            if (LIKELY(clientRequest)) {
+                _logger.log("%:% %() % Processing seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), clientRequest->seq, clientRequest->request.toString());
+                _requestSeq = clientRequest->seq;
+                processClientRequest(&clientRequest->request);
+                _incomingRequests->updateReadIndex();
+                watermark = _requestSeq + 1;
+            }
+
+            // the routed seq read above may lag behind the request just processed, the watermark never goes back
+            if (_shardResponses && watermark > _watermark.load(std::memory_order_relaxed))
+                _watermark.store(watermark, std::memory_order_release);
+        }
+    }
+
+    auto MatchingShard::processClientRequest(const MEClientRequest* clientRequest) noexcept -> void {
+        // a mass cancel over all tickers reaches every shard, each one goes through the books it owns and the last one
+        // acks it, the merger follows shard order for messages of the same request so the ack comes after every CANCELED
+        if (UNLIKELY(clientRequest->type == ClientRequestType::MASS_CANCEL && clientRequest->tickerId == TickerId_INVALID)) {
+            for (auto orderBook : _tickerOrderBook) {
+                if (orderBook)
+                    orderBook->massCancel(clientRequest->clientId, clientRequest->side);
+            }
+
+            if (_index == _router->numShards() - 1) {
+                const MEClientResponse ack{ClientResponseType::MASS_CANCELED, clientRequest->clientId, TickerId_INVALID, clientRequest->orderId, OrderId_INVALID, clientRequest->side,
+                                           Price_INVALID, Qty_INVALID, Qty_INVALID};
+                sendClientResponse(&ack);
+            }
+            return;
+        }
+
+        // the quotes of a mass quote are sequenced before it, the ack goes out after everything they sent
+        if (UNLIKELY(clientRequest->type == ClientRequestType::MASS_QUOTE_END)) {
+            const MEClientResponse ack{ClientResponseType::MASS_QUOTE_ACK, clientRequest->clientId, TickerId_INVALID, clientRequest->orderId, OrderId_INVALID, Side::Invalid,
+                                       Price_INVALID, Qty_INVALID, clientRequest->qty};
+            sendClientResponse(&ack);
+            return;
+        }
+
+        if (UNLIKELY(clientRequest->tickerId >= _tickerOrderBook.size())) {
+            _logger.log("%:% %() % WARN Ignoring request for unlisted ticker %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), clientRequest->toString());
+            return;
+        }
+        auto orderBook = _tickerOrderBook[clientRequest->tickerId];
+
+        switch (clientRequest->type)
+        {
+        case ClientRequestType::NEW:
+            orderBook->add(clientRequest->clientId, clientRequest->orderId, clientRequest->tickerId, clientRequest->side, clientRequest->price, clientRequest->qty);
+            break;
+        case ClientRequestType::CANCEL:
+            orderBook->cancel(clientRequest->clientId, clientRequest->orderId, clientRequest->tickerId);
+            break;
+        case ClientRequestType::MODIFY:
+            orderBook->modify(clientRequest->clientId, clientRequest->orderId, clientRequest->tickerId, clientRequest->price, clientRequest->qty);
+            break;
+        case ClientRequestType::MASS_CANCEL: {
+            const MEClientResponse ack{ClientResponseType::MASS_CANCELED, clientRequest->clientId, clientRequest->tickerId, clientRequest->orderId, OrderId_INVALID, clientRequest->side,
+                                       Price_INVALID, Qty_INVALID, static_cast<Qty>(orderBook->massCancel(clientRequest->clientId, clientRequest->side))};
+            sendClientResponse(&ack);
+            break;
+        }
+        case ClientRequestType::QUOTE:
+            orderBook->quote(clientRequest->clientId, clientRequest->orderId, clientRequest->side, clientRequest->price, clientRequest->qty);
+            break;
+        default:
+            FATAL("Received invalid client-request type: " + clientRequestTypeToString(clientRequest->type));
+            break;
+        }
+    }
+
+    auto MatchingShard::sendClientResponse(const MEClientResponse* clientResponse) noexcept -> void {
+        _logger.log("%:% %() % Sending %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), clientResponse->toString());
+        if (LIKELY(_outgoingOgwResponses)) {
+            auto nextWrite = _outgoingOgwResponses->getNextWriteTo();
+            *nextWrite = *clientResponse;
+            _outgoingOgwResponses->updateWriteIndex();
+        } else {
+            auto nextWrite = _shardResponses->getNextWriteTo();
+            nextWrite->requestSeq = _requestSeq;
+            nextWrite->msg = *clientResponse;
+            _shardResponses->updateWriteIndex();
+        }
+    }
+
+    auto MatchingShard::sendMarketUpdate(const MEMarketUpdate* marketUpdate) noexcept -> void {
+        _logger.log("%:% %() % Sending %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), marketUpdate->toString());
+        if (LIKELY(_outgoingMDUpdates)) {
+            auto nextWrite = _outgoingMDUpdates->getNextWriteTo();
+            *nextWrite = *marketUpdate;
+            _outgoingMDUpdates->updateWriteIndex();
+        } else {
+            auto nextWrite = _shardUpdates->getNextWriteTo();
+            nextWrite->requestSeq = _requestSeq;
+            nextWrite->msg = *marketUpdate;
+            _shardUpdates->updateWriteIndex();
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "lf_queue.h"
+#include "thread_utils.h"
+#include "macros.h"
+#include "logging.h"
+#include "client_request_router.h"
+#include "client_response.h"
+#include "market_update.h"
+
+#include "me_order_book.h"
+#include "shard_merger.h"
+
+using namespace Common;
+
+namespace Exchange {
+    // queues a matching shard sends through when its messages are merged with the ones of other shards
+    typedef LFQueue<ShardOutput<MEClientResponse>> ShardClientResponseLFQueue;
+    typedef LFQueue<ShardOutput<MEMarketUpdate>> ShardMarketUpdateLFQueue;
+
+    // matching thread owning the books of the tickers router hands to shard index, it sends straight to
+    // clientResponses & marketUpdates when it is the only shard and through its own queues to a ShardMerger otherwise
+    class MatchingShard final {
+        public:
+            MatchingShard(size_t index, ClientRequestRouter* router, ClientResponseLFQueue* clientResponses, MEMarketUpdateLFQueue* marketUpdates, const InstrumentRegistry& instruments,
+                          OrderBookType bookType = OrderBookType::LINKED_LIST, FillReporting fillReporting = FillReporting::PER_ORDER);
+            ~MatchingShard();
+            MatchingShard() = delete;
+            MatchingShard(const MatchingShard& ) = delete;
+            MatchingShard(const MatchingShard&& ) = delete;
+            MatchingShard &operator=(const MatchingShard& ) = delete;
+            MatchingShard &operator=(const MatchingShard&& ) = delete;
+
+            auto start() noexcept -> void;
+            auto stop() noexcept -> void;
+
+            auto sendClientResponse(const MEClientResponse* clientResponse) noexcept -> void;
+            auto sendMarketUpdate(const MEMarketUpdate* marketUpdate) noexcept -> void;
+
+            // method for handing the messages of this shard to mergers, only used with more than one shard
+            auto addTo(ShardMerger<MEClientResponse>* responseMerger, ShardMerger<MEMarketUpdate>* updateMerger) noexcept -> void;
+
+        private:
+            auto processClientRequest(const MEClientRequest* clientRequest) noexcept -> void;
+            auto run() noexcept -> void;
+
+            const size_t _index;
+            ClientRequestRouter* _router = nullptr;
+            SequencedClientRequestLFQueue* _incomingRequests = nullptr;
+            // outgoing order gateway responses & market data updates when this is the only shard
+            ClientResponseLFQueue* _outgoingOgwResponses = nullptr;
+            MEMarketUpdateLFQueue* _outgoingMDUpdates = nullptr;
+            // outgoing responses & updates tagged with the request they were sent for when there are other shards
+            ShardClientResponseLFQueue* _shardResponses = nullptr;
+            ShardMarketUpdateLFQueue* _shardUpdates = nullptr;
+            // seq of the request being processed
+            size_t _requestSeq = 0;
+            // every message sent from now on belongs to a request with this seq or later, read by the mergers
+            std::atomic<size_t> _watermark = {0};
+            volatile bool _run = false;
+            std::string _timeStr;
+            Logger _logger;
+            // books of the tickers owned by this shard, nullptr for the others
+            OrderBookHashMap _tickerOrderBook;
+    };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <vector>
 #include <sstream>
 #include <types.h>
 
@@ -17,10 +18,15 @@ namespace Exchange {
         Price price = Price_INVALID;
         Qty qty = Qty_INVALID;
         Priority priority = Priority_INVALID;
+        // placed by a QUOTE, found by its client & side instead of its client order id (the mass quote that placed it)
+        bool quote = false;
         // pointers used for implementing the double linked list
         // where each points to MEOrder of same price
         MEOrder* nextOrder = nullptr;
         MEOrder* prevOrder = nullptr;
+        // null terminated list of the orders the same client has resting in the book, walked by a mass cancel
+        MEOrder* nextClientOrder = nullptr;
+        MEOrder* prevClientOrder = nullptr;
 
         MEOrder() = default;
         MEOrder(TickerId ticker_id, ClientId client_id, OrderId client_order_id, OrderId market_order_id, Side side, Price price, Qty qty, Priority priority, MEOrder *prev_order, MEOrder *next_order) noexcept
@@ -70,10 +76,93 @@ namespace Exchange {
     };
 
 
-    // hash map implemented via std::array that encapsulated all Orders
-    typedef std::array<MEOrderAtPrice*, ME_MAX_PRICE_LEVELS> OrdersAtPriceHashMap;
-    // hash map that tracks orders
-    typedef std::array<MEOrder*, ME_MAX_ORDER_IDS> OrderHashMap;
-    // hash map that tracks orders of client
-    typedef std::array<OrderHashMap, ME_MAX_CLIENTS> ClientOrderHashMap;
+    // hash map that encapsulated all Orders, sized to the price levels of the instrument
+    typedef std::vector<MEOrderAtPrice*> OrdersAtPriceHashMap;
+    // open addressing index of the live orders of a book by (clientId, clientOrderId), sized to the orders the book
+    // can hold so it never has to grow: at most half its slots are taken, lookups probe linearly from the hash of the
+    // key and removal shifts the rest of a run back instead of leaving tombstones
+    class ClientOrderIndex final {
+    public:
+        explicit ClientOrderIndex(size_t maxOrders) {
+            size_t bits = 4;
+            while ((size_t{1} << bits) < maxOrders * 2)
+                bits++;
+            _slots.resize(size_t{1} << bits);
+            _mask = _slots.size() - 1;
+            _shift = 64 - bits;
+        }
+
+        ClientOrderIndex() = delete;
+        ClientOrderIndex(const ClientOrderIndex&) = delete;
+        ClientOrderIndex(const ClientOrderIndex&&) = delete;
+        ClientOrderIndex& operator=(const ClientOrderIndex&) = delete;
+        ClientOrderIndex& operator=(const ClientOrderIndex&&) = delete;
+
+        // function for finding the live order clientId sent as clientOrderId, nullptr if there is none
+        auto find(ClientId clientId, OrderId clientOrderId) const noexcept -> MEOrder* {
+            for (auto i = home(clientId, clientOrderId);; i = (i + 1) & _mask) {
+                const auto& slot = _slots[i];
+                if (!slot.order || (slot.clientOrderId == clientOrderId && slot.clientId == clientId))
+                    return slot.order;
+            }
+        }
+
+        // method for indexing order, an order of the client with the same clientOrderId is replaced
+        auto insert(MEOrder* order) noexcept -> void {
+            auto i = home(order->clientId, order->clientOrderId);
+            while (_slots[i].order && !(_slots[i].clientOrderId == order->clientOrderId && _slots[i].clientId == order->clientId))
+                i = (i + 1) & _mask;
+
+            _size += !_slots[i].order;
+            if (UNLIKELY(_size * 2 > _slots.size()))
+                FATAL("ClientOrderIndex over capacity:" + std::to_string(_slots.size()));
+            _slots[i] = {order->clientId, order->clientOrderId, order};
+        }
+
+        // method for removing the order clientId sent as clientOrderId
+        auto erase(ClientId clientId, OrderId clientOrderId) noexcept -> void {
+            auto i = home(clientId, clientOrderId);
+            while (_slots[i].order && !(_slots[i].clientOrderId == clientOrderId && _slots[i].clientId == clientId))
+                i = (i + 1) & _mask;
+            if (!_slots[i].order)
+                return;
+
+            // move later entries of the run into the hole unless that would put them before their home slot
+            for (auto j = (i + 1) & _mask; _slots[j].order; j = (j + 1) & _mask) {
+                const auto h = home(_slots[j].clientId, _slots[j].clientOrderId);
+                if (((j - h) & _mask) >= ((j - i) & _mask)) {
+                    _slots[i] = _slots[j];
+                    i = j;
+                }
+            }
+            _slots[i] = {};
+            _size--;
+        }
+
+        auto size() const noexcept -> size_t {
+            return _size;
+        }
+
+        auto memory() const noexcept -> size_t {
+            return _slots.size() * sizeof(Slot);
+        }
+
+    private:
+        struct Slot {
+            ClientId clientId = ClientId_INVALID;
+            OrderId clientOrderId = OrderId_INVALID;
+            MEOrder* order = nullptr;
+        };
+
+        // slot the probe for a key starts at (fibonacci hashing of the key)
+        auto home(ClientId clientId, OrderId clientOrderId) const noexcept -> size_t {
+            const auto key = (static_cast<uint64_t>(clientOrderId) ^ (static_cast<uint64_t>(clientId) << 40)) * 0x9E3779B97F4A7C15ull;
+            return static_cast<size_t>(key >> _shift);
+        }
+
+        std::vector<Slot> _slots;
+        size_t _mask = 0;
+        unsigned _shift = 0;
+        size_t _size = 0;
+    };
 }
\ No newline at end of file
@@ -1,61 +1,101 @@
-#include "matching_engine.h"
+#include "matching_shard.h"
 #include "me_order_book.h"
 
 namespace Exchange {
-    MEOrderBook::MEOrderBook(TickerId tickerId, Logger* logger, MatchingEngine* matchingEngine):
-        _tickerId(tickerId), _logger(logger), _matchingEngine(matchingEngine), 
-        _ordersAtPricePool(ME_MAX_PRICE_LEVELS), _orderPool(ME_MAX_ORDER_IDS) {}
+    MEOrderBook::MEOrderBook(const InstrumentCfg& instrument, Logger* logger, MatchingShard* matchingShard, OrderBookType type, FillReporting fillReporting):
+        _tickerId(instrument.tickerId), _instrument(instrument), _logger(logger), _matchingShard(matchingShard), _cidOidToOrder(instrument.maxOrders),
+        _priceOrdersAtPrice(type == OrderBookType::LINKED_LIST ? instrument.maxPriceLevels : 0, nullptr), _fillReporting(fillReporting),
+        // each ladder holds a level per tick of its window, the linked list book at most a level per slot
+        _ordersAtPricePool(type == OrderBookType::PRICE_LADDER ? 2 * PriceLadder::windowTicks(instrument.maxPriceLevels) : instrument.maxPriceLevels), _orderPool(instrument.maxOrders) {
+        if (type == OrderBookType::PRICE_LADDER) {
+            _bidLadder = new PriceLadder(instrument.maxPriceLevels, instrument.tickSize);
+            _askLadder = new PriceLadder(instrument.maxPriceLevels, instrument.tickSize);
+        }
+    }
 
     MEOrderBook::~MEOrderBook() {
         _logger->log("%:% %() % OrderBook\n%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), toString(false, true));
-        _matchingEngine = nullptr;
+        if (_bidLadder)
+            _logger->log("%:% %() % ladder recenters bids:% asks:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), _bidLadder->recenters(), _askLadder->recenters());
+        _matchingShard = nullptr;
         _bidsByPrice = _asksByPrice = nullptr;
-        for (auto &itr : _cidOidToOrder)
-        {
-            itr.fill(nullptr);
-        }
+        delete _bidLadder;
+        delete _askLadder;
+        _bidLadder = _askLadder = nullptr;
     }
 
     auto MEOrderBook::generateNewMarketOrderId() noexcept -> OrderId {
+        if (UNLIKELY(_nextMarketOrderId == OrderId_INVALID))
+            FATAL("Market order ids exhausted for ticker:" + tickerIdToString(_tickerId));
         return _nextMarketOrderId++;
     }
 
-    auto MEOrderBook::priceToIndex(Price price) const noexcept -> int {
-        return (price % ME_MAX_PRICE_LEVELS);
+    auto MEOrderBook::priceToIndex(Price price) const noexcept -> size_t {
+        return _instrument.priceToIndex(price);
     }
-    
-    auto MEOrderBook::getOrdersAtPrice(Price price) const noexcept {
+
+    auto MEOrderBook::getOrdersAtPrice(Side side, Price price) const noexcept -> MEOrderAtPrice* {
+        if (_bidLadder)
+            return (side == Side::Buy ? _bidLadder : _askLadder)->at(price);
         return _priceOrdersAtPrice.at(priceToIndex(price));
     }
 
+    auto MEOrderBook::canRest(Side side, Price price) noexcept -> bool {
+        if (!_bidLadder)
+            return true;
+        return (side == Side::Buy ? _bidLadder : _askLadder)->reserve(price);
+    }
+
     auto MEOrderBook::add(ClientId clientId, OrderId clientOrderId, TickerId tickerId, Side side, Price price, Qty qty) noexcept -> void {
         auto marketOrderId = generateNewMarketOrderId();
         _clientResponse = {ClientResponseType::ACCEPTED, clientId, tickerId, clientOrderId, marketOrderId, side, price, 0, qty};
-        _matchingEngine->sendClientResponse(&_clientResponse);
+        _matchingShard->sendClientResponse(&_clientResponse);
 
         // check if we have a match against a passive order partial or full
         auto leavesQty = checkForMatch(clientId, clientOrderId, tickerId, side, price, qty, marketOrderId);
 
         // create new marketOrder if any qty is left out
         if (LIKELY(leavesQty)) {
-            const auto priority = getNextPriority(price);
+            // too far from the rest of its side for the ladder, what is left of the order is canceled
+            if (UNLIKELY(!canRest(side, price))) {
+                _clientResponse = {ClientResponseType::CANCELED, clientId, tickerId, clientOrderId, marketOrderId, side, price, Qty_INVALID, leavesQty};
+                _matchingShard->sendClientResponse(&_clientResponse);
+                return;
+            }
+
+            const auto priority = getNextPriority(side, price);
             auto order = _orderPool.allocate(tickerId, clientId, clientOrderId, marketOrderId, side, price, leavesQty, priority, nullptr, nullptr);
             addOrder(order);
             _marketUpdate = {MarketUpdateType::ADD, marketOrderId, tickerId, side, price, leavesQty, priority};
-            _matchingEngine->sendMarketUpdate(&_marketUpdate);
+            _matchingShard->sendMarketUpdate(&_marketUpdate);
         } 
     }
 
 
-    auto MEOrderBook::getNextPriority(Price price) const noexcept -> uint64_t {
-        const auto ordersAtPrice = getOrdersAtPrice(price);
+    auto MEOrderBook::getNextPriority(Side side, Price price) const noexcept -> Priority {
+        const auto ordersAtPrice = getOrdersAtPrice(side, price);
         if (!ordersAtPrice)
             return 1lu;
         return ordersAtPrice->firstMeOrder->prevOrder->priority + 1;
     }
 
     auto MEOrderBook::addOrder(MEOrder* order) noexcept -> void {
-        const auto ordersAtPrice = getOrdersAtPrice(order->price);
+        linkOrder(order);
+        if (LIKELY(!order->quote))
+            _cidOidToOrder.insert(order);
+        else
+            _clientQuotes.at(order->clientId)[sideToIndex(order->side)] = order;
+
+        auto& clientOrders = _clientOrders.at(order->clientId);
+        order->prevClientOrder = nullptr;
+        order->nextClientOrder = clientOrders;
+        if (clientOrders)
+            clientOrders->prevClientOrder = order;
+        clientOrders = order;
+    }
+
+    auto MEOrderBook::linkOrder(MEOrder* order) noexcept -> void {
+        const auto ordersAtPrice = getOrdersAtPrice(order->side, order->price);
         if (!ordersAtPrice) {
             // if there was not order at that price level before
             order->nextOrder = order->prevOrder = order;
@@ -63,16 +103,40 @@ namespace Exchange {
             addOrdersAtPrice(newOrderAtPrice);       
         } else {
             // add newly created order at the end of the list
-            auto firstOrder = (ordersAtPrice ? ordersAtPrice->firstMeOrder : nullptr);
+            auto firstOrder = ordersAtPrice->firstMeOrder;
             firstOrder->prevOrder->nextOrder = order;
             order->prevOrder = firstOrder->prevOrder;
-            order->nextOrder = nullptr;
+            order->nextOrder = firstOrder;
             firstOrder->prevOrder = order;
-            _cidOidToOrder.at(order->clientId).at(order->clientOrderId) = order;
         }
     }
 
     auto MEOrderBook::addOrdersAtPrice(MEOrderAtPrice* newOrdersAtPrice) noexcept -> void {
+        if (_bidLadder) {
+            const auto isBid = (newOrdersAtPrice->side == Side::Buy);
+            auto ladder = (isBid ? _bidLadder : _askLadder);
+            ladder->insert(newOrdersAtPrice);
+
+            // the level that ranks right before the new one (next higher bid / next lower ask) is found in the
+            // ladder's bitmap, without one the new level becomes the best of its side
+            auto& best = (isBid ? _bidsByPrice : _asksByPrice);
+            if (UNLIKELY(!best)) {
+                best = newOrdersAtPrice->prevEntry = newOrdersAtPrice->nextEntry = newOrdersAtPrice;
+                return;
+            }
+
+            const auto ahead = (isBid ? ladder->above(newOrdersAtPrice->price) : ladder->below(newOrdersAtPrice->price));
+            // a new best goes in front of the old one, which is right after the worst level in the circular list
+            const auto target = (ahead ? ahead : best->prevEntry);
+            newOrdersAtPrice->prevEntry = target;
+            newOrdersAtPrice->nextEntry = target->nextEntry;
+            target->nextEntry->prevEntry = newOrdersAtPrice;
+            target->nextEntry = newOrdersAtPrice;
+            if (!ahead)
+                best = newOrdersAtPrice;
+            return;
+        }
+
         _priceOrdersAtPrice.at(priceToIndex(newOrdersAtPrice->price)) = newOrdersAtPrice;
 
         // update bids or asks by price
@@ -120,29 +184,159 @@ namespace Exchange {
     }
 
     auto MEOrderBook::cancel(ClientId clientId, OrderId orderId, TickerId tickerId) noexcept -> void {
-        auto isCancable =  (clientId < _cidOidToOrder.size());
-        MEOrder* exchangeOrder = nullptr;
-        if (LIKELY(isCancable)) {
-            auto &coItr = _cidOidToOrder.at(clientId);
-            exchangeOrder = coItr.at(orderId);
-            isCancable = (exchangeOrder != nullptr);
-        }
-
-        if (UNLIKELY(!isCancable)) {
+        const auto exchangeOrder = _cidOidToOrder.find(clientId, orderId);
+        if (UNLIKELY(!exchangeOrder)) {
             _clientResponse = {ClientResponseType::CANCEL_REJECTED, clientId, tickerId, orderId, OrderId_INVALID, Side::Invalid, Price_INVALID, Qty_INVALID, Qty_INVALID};
         } else {
             _clientResponse = {ClientResponseType::CANCELED, clientId, tickerId, orderId, exchangeOrder->marketOrderId, exchangeOrder->side, exchangeOrder->price, Qty_INVALID ,exchangeOrder->qty};
             _marketUpdate =  {MarketUpdateType::CANCEL, exchangeOrder->marketOrderId, tickerId, exchangeOrder->side, exchangeOrder->price, 0, exchangeOrder->priority};
             
             removeOrder(exchangeOrder);
-            _matchingEngine->sendMarketUpdate(&_marketUpdate);
+            _matchingShard->sendMarketUpdate(&_marketUpdate);
+        }
+
+        _matchingShard->sendClientResponse(&_clientResponse);
+    }
+
+    auto MEOrderBook::modify(ClientId clientId, OrderId orderId, TickerId tickerId, Price price, Qty qty) noexcept -> void {
+        const auto order = _cidOidToOrder.find(clientId, orderId);
+        // an amend to nothing is a cancel, a price the ladder can not hold leaves the order as it was
+        if (UNLIKELY(!order || !qty || qty == Qty_INVALID || price == Price_INVALID || (price != order->price && !canRest(order->side, price)))) {
+            _clientResponse = {ClientResponseType::MODIFY_REJECTED, clientId, tickerId, orderId, (order ? order->marketOrderId : OrderId_INVALID),
+                               (order ? order->side : Side::Invalid), price, Qty_INVALID, qty};
+            _matchingShard->sendClientResponse(&_clientResponse);
+            return;
+        }
+
+        _clientResponse = {ClientResponseType::MODIFIED, clientId, tickerId, orderId, order->marketOrderId, order->side, price, 0, qty};
+        _matchingShard->sendClientResponse(&_clientResponse);
+        amend(order, price, qty);
+    }
+
+    auto MEOrderBook::amend(MEOrder* order, Price price, Qty qty) noexcept -> void {
+        const auto oldPrice = order->price;
+        const auto oldQty = order->qty;
+
+        // less qty at the same price keeps its place in the queue
+        if (price == oldPrice && qty <= oldQty) {
+            order->qty = qty;
+            _marketUpdate = {MarketUpdateType::MODIFY, order->marketOrderId, _tickerId, order->side, price, qty, order->priority};
+            _matchingShard->sendMarketUpdate(&_marketUpdate);
+            return;
+        }
+
+        // anything else is taken out of its level and matched & rested as a new order would be, under the same ids
+        unlinkOrder(order);
+        const auto leavesQty = (price == oldPrice ? qty : checkForMatch(order->clientId, order->clientOrderId, _tickerId, order->side, price, qty, order->marketOrderId));
+        if (UNLIKELY(!leavesQty)) {
+            _marketUpdate = {MarketUpdateType::CANCEL, order->marketOrderId, _tickerId, order->side, oldPrice, 0, order->priority};
+            _matchingShard->sendMarketUpdate(&_marketUpdate);
+            releaseOrder(order);
+            return;
+        }
+
+        order->price = price;
+        order->qty = leavesQty;
+        order->priority = getNextPriority(order->side, price);
+        linkOrder(order);
+        _marketUpdate = {MarketUpdateType::MODIFY, order->marketOrderId, _tickerId, order->side, price, leavesQty, order->priority};
+        _matchingShard->sendMarketUpdate(&_marketUpdate);
+    }
+
+    auto MEOrderBook::quote(ClientId clientId, OrderId quoteId, Side side, Price price, Qty qty) noexcept -> void {
+        if (UNLIKELY(side != Side::Buy && side != Side::Sell)) {
+            _logger->log("%:% %() % WARN Ignoring quote of client:% qid:% without a side\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), clientId, quoteId);
+            return;
+        }
+
+        const auto order = _clientQuotes.at(clientId)[sideToIndex(side)];
+        const bool pull = (!qty || qty == Qty_INVALID || price == Price_INVALID);
+        if (order) {
+            // a market maker re-sending what it quotes already keeps its place & sends nothing
+            if (!pull && price == order->price && qty == order->qty) {
+                order->clientOrderId = quoteId;
+                return;
+            }
+
+            // pulled, or moved to a price the ladder can not hold, a stale quote is worse than none
+            if (pull || (price != order->price && UNLIKELY(!canRest(side, price)))) {
+                if (!pull) {
+                    _clientResponse = {ClientResponseType::CANCELED, clientId, _tickerId, quoteId, order->marketOrderId, side, price, Qty_INVALID, qty};
+                    _matchingShard->sendClientResponse(&_clientResponse);
+                }
+                _marketUpdate = {MarketUpdateType::CANCEL, order->marketOrderId, _tickerId, side, order->price, 0, order->priority};
+                _matchingShard->sendMarketUpdate(&_marketUpdate);
+                removeOrder(order);
+                return;
+            }
+
+            order->clientOrderId = quoteId;
+            amend(order, price, qty);
+            return;
+        }
+
+        if (pull)
+            return;
+
+        // placed as add() would, without the ACCEPTED
+        const auto marketOrderId = generateNewMarketOrderId();
+        const auto leavesQty = checkForMatch(clientId, quoteId, _tickerId, side, price, qty, marketOrderId);
+        if (LIKELY(leavesQty)) {
+            if (UNLIKELY(!canRest(side, price))) {
+                _clientResponse = {ClientResponseType::CANCELED, clientId, _tickerId, quoteId, marketOrderId, side, price, Qty_INVALID, leavesQty};
+                _matchingShard->sendClientResponse(&_clientResponse);
+                return;
+            }
+
+            const auto priority = getNextPriority(side, price);
+            auto newQuote = _orderPool.allocate(_tickerId, clientId, quoteId, marketOrderId, side, price, leavesQty, priority, nullptr, nullptr);
+            newQuote->quote = true;
+            addOrder(newQuote);
+            _marketUpdate = {MarketUpdateType::ADD, marketOrderId, _tickerId, side, price, leavesQty, priority};
+            _matchingShard->sendMarketUpdate(&_marketUpdate);
         }
+    }
 
-        _matchingEngine->sendClientResponse(&_clientResponse);
+    auto MEOrderBook::massCancel(ClientId clientId, Side side) noexcept -> size_t {
+        size_t canceled = 0;
+        for (auto order = _clientOrders.at(clientId); order;) {
+            const auto next = order->nextClientOrder;
+            if (side == Side::Invalid || order->side == side) {
+                _clientResponse = {ClientResponseType::CANCELED, clientId, _tickerId, order->clientOrderId, order->marketOrderId, order->side, order->price, Qty_INVALID, order->qty};
+                _matchingShard->sendClientResponse(&_clientResponse);
+                _marketUpdate = {MarketUpdateType::CANCEL, order->marketOrderId, _tickerId, order->side, order->price, 0, order->priority};
+                _matchingShard->sendMarketUpdate(&_marketUpdate);
+                removeOrder(order);
+                canceled++;
+            }
+            order = next;
+        }
+        return canceled;
     }
 
     auto MEOrderBook::removeOrder(MEOrder* order) noexcept -> void {
-        auto ordersAtPrice = getOrdersAtPrice(order->price);
+        unlinkOrder(order);
+        releaseOrder(order);
+    }
+
+    auto MEOrderBook::releaseOrder(MEOrder* order) noexcept -> void {
+        if (LIKELY(!order->quote))
+            _cidOidToOrder.erase(order->clientId, order->clientOrderId);
+        else
+            _clientQuotes.at(order->clientId)[sideToIndex(order->side)] = nullptr;
+
+        if (order->prevClientOrder)
+            order->prevClientOrder->nextClientOrder = order->nextClientOrder;
+        else
+            _clientOrders.at(order->clientId) = order->nextClientOrder;
+        if (order->nextClientOrder)
+            order->nextClientOrder->prevClientOrder = order->prevClientOrder;
+
+        _orderPool.deallocate(order);
+    }
+
+    auto MEOrderBook::unlinkOrder(MEOrder* order) noexcept -> void {
+        auto ordersAtPrice = getOrdersAtPrice(order->side, order->price);
         if (order->prevOrder == order) { // only one element at that price level, remove it
             removeOrdersAtPrice(order->side, order->price);
         } else { // remove the order from the price level 
@@ -156,15 +350,12 @@ namespace Exchange {
             }
             order->prevOrder = order->nextOrder = order;
         }
-
-        _cidOidToOrder.at(order->clientId).at(order->clientOrderId) = nullptr;
-        _orderPool.deallocate(order);
     }
 
 
     auto MEOrderBook::removeOrdersAtPrice(Side side, Price price) noexcept -> void {
         const auto bestOrdersAtPrice = (side == Side::Buy? _bidsByPrice : _asksByPrice);
-        auto ordersAtPrice = getOrdersAtPrice(price);
+        auto ordersAtPrice = getOrdersAtPrice(side, price);
         if (UNLIKELY(ordersAtPrice->nextEntry == ordersAtPrice)) { // only price at that price level
             (side == Side::Buy? _bidsByPrice : _asksByPrice) = nullptr;
         } else {
@@ -176,8 +367,13 @@ namespace Exchange {
             }
             
             ordersAtPrice->prevEntry = ordersAtPrice->nextEntry = ordersAtPrice;
-            _ordersAtPricePool.deallocate(ordersAtPrice);
         }
+
+        if (_bidLadder)
+            (side == Side::Buy ? _bidLadder : _askLadder)->erase(price);
+        else
+            _priceOrdersAtPrice.at(priceToIndex(price)) = nullptr;
+        _ordersAtPricePool.deallocate(ordersAtPrice);
     }
 
     auto MEOrderBook::checkForMatch(ClientId clientId, OrderId clientOrderId, TickerId tickerId, Side side, Price price, Qty qty, OrderId newMarketOrderId) noexcept -> Qty {
@@ -190,7 +386,10 @@ namespace Exchange {
                 if (LIKELY(price < askItr->price))
                     break;
 
-                match(tickerId, clientId, side, clientOrderId, newMarketOrderId, askItr, &leavesQty);
+                if (_fillReporting == FillReporting::PER_LEVEL)
+                    sweep(clientId, side, clientOrderId, newMarketOrderId, _asksByPrice, &leavesQty);
+                else
+                    match(tickerId, clientId, side, clientOrderId, newMarketOrderId, askItr, &leavesQty);
             }
         } 
 
@@ -201,7 +400,10 @@ namespace Exchange {
                 if (LIKELY(price > bidsItr->price))
                     break;
 
-                match(tickerId, clientId, side, clientOrderId, newMarketOrderId, bidsItr, &leavesQty);
+                if (_fillReporting == FillReporting::PER_LEVEL)
+                    sweep(clientId, side, clientOrderId, newMarketOrderId, _bidsByPrice, &leavesQty);
+                else
+                    match(tickerId, clientId, side, clientOrderId, newMarketOrderId, bidsItr, &leavesQty);
             }
         }
 
@@ -218,24 +420,76 @@ namespace Exchange {
 
         // response to the client who had the aggressive order
         _clientResponse = {ClientResponseType::FILLED, clientId, tickerId, clientOrderId, newMarketOrderId, side, itr->price, fillQty, *leavesQty};
-        _matchingEngine->sendClientResponse(&_clientResponse);
+        _matchingShard->sendClientResponse(&_clientResponse);
 
         // response to the client who had the passive order
         _clientResponse = {ClientResponseType::FILLED, order->clientId, tickerId, order->clientOrderId, order->marketOrderId, order->side, itr->price, fillQty, order->qty};
-        _matchingEngine->sendClientResponse(&_clientResponse);
+        _matchingShard->sendClientResponse(&_clientResponse);
 
         // notify other users of the market update comming from the aggresive order
         _marketUpdate = {MarketUpdateType::TRADE, OrderId_INVALID, tickerId, side, itr->price, fillQty, Priority_INVALID};
-        _matchingEngine->sendMarketUpdate(&_marketUpdate);
+        _matchingShard->sendMarketUpdate(&_marketUpdate);
 
         // notify other users of the market update comming from the passive order
         if(!order->qty) {
-            _marketUpdate = {MarketUpdateType::CANCEL, order->marketOrderId, tickerId, order->side, order->price, orderQty, Price_INVALID};
-            _matchingEngine->sendMarketUpdate(&_marketUpdate);
+            _marketUpdate = {MarketUpdateType::CANCEL, order->marketOrderId, tickerId, order->side, order->price, 0, order->priority};
+            _matchingShard->sendMarketUpdate(&_marketUpdate);
             removeOrder(order);
         } else {
-            _marketUpdate = {MarketUpdateType::MODIFY, order->marketOrderId, tickerId, order->side, order->price, orderQty, order->priority};
-            _matchingEngine->sendMarketUpdate(&_marketUpdate);
+            _marketUpdate = {MarketUpdateType::MODIFY, order->marketOrderId, tickerId, order->side, order->price, order->qty, order->priority};
+            _matchingShard->sendMarketUpdate(&_marketUpdate);
+        }
+    }
+
+    auto MEOrderBook::sweep(ClientId clientId, Side side, OrderId clientOrderId, OrderId newMarketOrderId, MEOrderAtPrice* level, Qty* leavesQty) noexcept -> void {
+        const auto price = level->price;
+        const auto levelSide = level->side;
+
+        // whether leavesQty takes the whole level, counted no further than leavesQty reaches
+        uint64_t levelQty = 0;
+        auto order = level->firstMeOrder;
+        do {
+            levelQty += order->qty;
+            order = order->nextOrder;
+        } while (levelQty <= *leavesQty && order != level->firstMeOrder);
+        const bool clears = (levelQty <= *leavesQty);
+        const Qty fillQty = (clears ? static_cast<Qty>(levelQty) : *leavesQty);
+        *leavesQty -= fillQty;
+
+        // one fill & one print for the level
+        _clientResponse = {ClientResponseType::FILLED, clientId, _tickerId, clientOrderId, newMarketOrderId, side, price, fillQty, *leavesQty};
+        _matchingShard->sendClientResponse(&_clientResponse);
+        _marketUpdate = {MarketUpdateType::TRADE, OrderId_INVALID, _tickerId, side, price, fillQty, Priority_INVALID};
+        _matchingShard->sendMarketUpdate(&_marketUpdate);
+
+        // the passive side in priority order, only a level left partly standing sends its orders' updates
+        for (auto levelLeft = fillQty; levelLeft;) {
+            order = level->firstMeOrder;
+            const auto orderQty = order->qty;
+            const auto orderFillQty = std::min(orderQty, levelLeft);
+            levelLeft -= orderFillQty;
+            order->qty -= orderFillQty;
+
+            _clientResponse = {ClientResponseType::FILLED, order->clientId, _tickerId, order->clientOrderId, order->marketOrderId, order->side, price, orderFillQty, order->qty};
+            _matchingShard->sendClientResponse(&_clientResponse);
+
+            if (order->qty) {
+                _marketUpdate = {MarketUpdateType::MODIFY, order->marketOrderId, _tickerId, order->side, price, order->qty, order->priority};
+                _matchingShard->sendMarketUpdate(&_marketUpdate);
+                continue;
+            }
+
+            if (!clears) {
+                _marketUpdate = {MarketUpdateType::CANCEL, order->marketOrderId, _tickerId, order->side, price, 0, order->priority};
+                _matchingShard->sendMarketUpdate(&_marketUpdate);
+            }
+            // frees level with its last order
+            removeOrder(order);
+        }
+
+        if (clears) {
+            _marketUpdate = {MarketUpdateType::LEVEL_CLEAR, OrderId_INVALID, _tickerId, levelSide, price, 0, Priority_INVALID};
+            _matchingShard->sendMarketUpdate(&_marketUpdate);
         }
     }
 
@@ -278,6 +532,7 @@ namespace Exchange {
                 if ((side == Side::Sell && lastPrice >= itr->price) || (side == Side::Buy && lastPrice <= itr->price)) {
                     FATAL("Bids/Asks not sorted by ascending/descending prices last:" + priceToString(lastPrice) + " itr:" + itr->toString());
                 }
+                lastPrice = itr->price;
             }
         };
 
@@ -299,11 +554,11 @@ namespace Exchange {
         // print bids
         {
             auto bidsItr = _bidsByPrice;
-            auto lastAskPrice = std::numeric_limits<Price>::max();
+            auto lastBidPrice = std::numeric_limits<Price>::max();
             for (size_t count = 0; bidsItr; ++count) {
-                ss << "ASKS L:" << count << " => ";
+                ss << "BIDS L:" << count << " => ";
                 auto nextBidsItr = (bidsItr->nextEntry == _bidsByPrice? nullptr : bidsItr->nextEntry);
-                printer(ss, bidsItr, Side::Sell, lastAskPrice, validity_check);
+                printer(ss, bidsItr, Side::Buy, lastBidPrice, validity_check);
                 bidsItr = nextBidsItr;
             }
         }
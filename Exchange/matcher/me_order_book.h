@@ -1,20 +1,53 @@
 #pragma once
 
 #include "types.h"
+#include "instrument_registry.h"
 #include "mem_pool.h"
 #include "logging.h"
 #include "client_response.h"
 #include "market_update.h"
 #include "me_order.h"
+#include "price_ladder.h"
 
 using namespace Common;
 
 namespace Exchange {
-    class MatchingEngine;
+    class MatchingShard;
+
+    enum class OrderBookType : uint8_t {
+        LINKED_LIST = 0, // levels in slots of price % levels, a new level walks the list of its side to find its place
+        PRICE_LADDER = 1 // levels by tick in a PriceLadder per side, a new level finds its neighbour in the bitmap
+    };
+
+    inline auto orderBookTypeToString(OrderBookType type) -> std::string {
+        switch (type) {
+            case OrderBookType::LINKED_LIST:
+                return "LINKED_LIST";
+            case OrderBookType::PRICE_LADDER:
+                return "PRICE_LADDER";
+        }
+        return "UNKNOWN";
+    }
+
+    enum class FillReporting : uint8_t {
+        PER_ORDER = 0, // the aggressor gets a FILLED, the feed a TRADE & a CANCEL/MODIFY for every resting order hit
+        PER_LEVEL = 1 // the aggressor gets a FILLED & the feed a TRADE per price level, a level taken whole is a single LEVEL_CLEAR
+    };
+
+    inline auto fillReportingToString(FillReporting reporting) -> std::string {
+        switch (reporting) {
+            case FillReporting::PER_ORDER:
+                return "PER_ORDER";
+            case FillReporting::PER_LEVEL:
+                return "PER_LEVEL";
+        }
+        return "UNKNOWN";
+    }
 
     class MEOrderBook final {
     public:
-        MEOrderBook(TickerId tickerId, Logger* logger, MatchingEngine* matchingEngine);
+        MEOrderBook(const InstrumentCfg& instrument, Logger* logger, MatchingShard* matchingShard, OrderBookType type = OrderBookType::LINKED_LIST,
+                    FillReporting fillReporting = FillReporting::PER_ORDER);
         ~MEOrderBook();
         MEOrderBook() = delete;
         MEOrderBook(const MEOrderBook &) = delete;
@@ -26,17 +59,36 @@ namespace Exchange {
         auto add(ClientId clientId, OrderId clientOrderId, TickerId tickerId, Side side, Price price, Qty qty) noexcept -> void;
         // method for cancelling order
         auto cancel(ClientId clientId, OrderId orderId, TickerId tickerId) noexcept -> void;
+        // method for amending price & qty of a resting order in place, it keeps its priority when only its qty goes
+        // down and goes to the back of its (new) level otherwise, a new price that crosses matches like a new order
+        auto modify(ClientId clientId, OrderId orderId, TickerId tickerId, Price price, Qty qty) noexcept -> void;
+        // method for cancelling every order clientId has in the book, or the ones of side unless it is Side::Invalid,
+        // a CANCELED & a market update go out per order, returns the number of orders canceled
+        auto massCancel(ClientId clientId, Side side) noexcept -> size_t;
+        // method for replacing the quote clientId has on side with price & qty (placing it if it has none) under
+        // quoteId, qty 0 pulls it, only fills & a quote the book can not rest get a response, the mass quote is acked as a whole
+        auto quote(ClientId clientId, OrderId quoteId, Side side, Price price, Qty qty) noexcept -> void;
     private:
         auto generateNewMarketOrderId() noexcept -> OrderId;
-        auto priceToIndex(Price price) const noexcept -> int;
+        auto priceToIndex(Price price) const noexcept -> size_t;
         auto toString(bool detailed, bool validity_check) const noexcept -> std::string;
-        auto getOrdersAtPrice(Price price) const noexcept;
+        auto getOrdersAtPrice(Side side, Price price) const noexcept -> MEOrderAtPrice*;
+        // function for checking that an order can rest at price, a ladder may have to recenter first
+        auto canRest(Side side, Price price) noexcept -> bool;
         // function for getting priority of order
-        auto getNextPriority(Price price) const noexcept -> uint64_t;
+        auto getNextPriority(Side side, Price price) const noexcept -> Priority;
         // function for adding order to OrderBook
         auto addOrder(MEOrder* order) noexcept -> void;
         // function for removing order from OrderBook
         auto removeOrder(MEOrder* order) noexcept -> void;
+        // function for moving order to price & qty as modify() does, it is freed if it fills completely
+        auto amend(MEOrder* order, Price price, Qty qty) noexcept -> void;
+        // function for putting order at the back of its price level
+        auto linkOrder(MEOrder* order) noexcept -> void;
+        // function for taking order out of its price level, it stays allocated & indexed by client order id
+        auto unlinkOrder(MEOrder* order) noexcept -> void;
+        // function for dropping an order already taken out of its price level from the indexes & freeing it
+        auto releaseOrder(MEOrder* order) noexcept -> void;
         // function for adding new price level to OrderBook
         auto addOrdersAtPrice(MEOrderAtPrice* newOrdersAtPrice) noexcept -> void;
         // function for removing price level from OrderBook
@@ -45,13 +97,25 @@ namespace Exchange {
         auto checkForMatch(ClientId clientId, OrderId clientOrderId, TickerId tickerId, Side side, Price price, Qty qty, OrderId newMarketOrderId) noexcept -> Qty;
         // function for matching aggressive order up against iterator provided and sends client response and market updates
         auto match(TickerId tickerId, ClientId clientId, Side side, OrderId clientOrderId, OrderId newMarketOrderId, MEOrder* itr, Qty* leavesQty) noexcept -> void;
+        // function for matching an aggressive order up against the orders of level with FillReporting::PER_LEVEL, passive
+        // clients still get a FILLED per order
+        auto sweep(ClientId clientId, Side side, OrderId clientOrderId, OrderId newMarketOrderId, MEOrderAtPrice* level, Qty* leavesQty) noexcept -> void;
 
         TickerId _tickerId = TickerId_INVALID;
-        MatchingEngine* _matchingEngine = nullptr;
-        ClientOrderHashMap _cidOidToOrder;
-        MEOrderAtPrice* _bidsByPrice; // tracks bids
-        MEOrderAtPrice* _asksByPrice; // tracks asks
+        const InstrumentCfg _instrument;
+        MatchingShard* _matchingShard = nullptr;
+        ClientOrderIndex _cidOidToOrder;
+        // most recently added resting order of every client, the head of its list of orders in this book
+        std::array<MEOrder*, ME_MAX_CLIENTS> _clientOrders{};
+        // resting quote of every client by side, quotes are not in _cidOidToOrder as a mass quote places many under one id
+        std::array<std::array<MEOrder*, sideToIndex(Side::Max)>, ME_MAX_CLIENTS> _clientQuotes{};
+        MEOrderAtPrice* _bidsByPrice = nullptr; // tracks bids
+        MEOrderAtPrice* _asksByPrice = nullptr; // tracks asks
         OrdersAtPriceHashMap _priceOrdersAtPrice; // array that holds orders of different prices
+        // levels of each side with OrderBookType::PRICE_LADDER, nullptr otherwise
+        PriceLadder* _bidLadder = nullptr;
+        PriceLadder* _askLadder = nullptr;
+        const FillReporting _fillReporting = FillReporting::PER_ORDER;
         MemPool<MEOrder> _orderPool;
         MemPool<MEOrderAtPrice> _ordersAtPricePool;
         MEClientResponse _clientResponse;
@@ -62,5 +126,5 @@ namespace Exchange {
     };
 
     // collection of order books for different trading instruments
-    typedef std::array<MEOrderBook *, ME_MAX_TICKERS> OrderBookHashMap;
+    typedef std::vector<MEOrderBook *> OrderBookHashMap;
 }
\ No newline at end of file
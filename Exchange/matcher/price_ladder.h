@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include "hierarchical_bitmap.h"
+#include "me_order.h"
+
+using namespace Common;
+
+namespace Exchange {
+    // the price levels of one side of a book in a window of ticks starting at _base, a level is found by its tick
+    // instead of a hash slot and the occupied ticks are kept in a HierarchicalBitmap, which finds the levels next to
+    // a price in O(1), when a price falls outside the window it is moved (recentered) around the levels it holds
+    class PriceLadder final {
+    public:
+        // window of at least ticks ticks of tickSize
+        PriceLadder(size_t ticks, Price tickSize) : _tickSize(tickSize), _levels(windowTicks(ticks), nullptr), _occupied(_levels.size()) {}
+
+        PriceLadder() = delete;
+        PriceLadder(const PriceLadder&) = delete;
+        PriceLadder(const PriceLadder&&) = delete;
+        PriceLadder& operator=(const PriceLadder&) = delete;
+        PriceLadder& operator=(const PriceLadder&&) = delete;
+
+        // function for the ticks of the window a ladder asked for ticks gets, also the most levels it can hold
+        static constexpr auto windowTicks(size_t ticks) noexcept -> size_t {
+            return std::bit_ceil(std::max<size_t>(ticks, 64));
+        }
+
+        // function for the level of price, nullptr if there is none
+        auto at(Price price) const noexcept -> MEOrderAtPrice* {
+            const auto tick = toTick(price);
+            if (UNLIKELY(tick < 0 || tick >= static_cast<int64_t>(_levels.size())))
+                return nullptr;
+            const auto level = _levels[tick];
+            return (level && level->price == price ? level : nullptr);
+        }
+
+        // method for making room for a level at price, recentering the window if needed, returns false if the
+        // levels held & price do not fit a window or another price of the same tick holds the slot (off tick prices)
+        auto reserve(Price price) noexcept -> bool {
+            auto tick = toTick(price);
+            if (UNLIKELY(tick < 0 || tick >= static_cast<int64_t>(_levels.size()))) {
+                if (!recenter(tick))
+                    return false;
+                tick = toTick(price);
+            }
+            return (!_levels[tick] || _levels[tick]->price == price);
+        }
+
+        // method for adding level, reserve() has to have been called for its price
+        auto insert(MEOrderAtPrice* level) noexcept -> void {
+            const auto tick = toTick(level->price);
+            _levels[tick] = level;
+            _occupied.set(tick);
+        }
+
+        auto erase(Price price) noexcept -> void {
+            const auto tick = toTick(price);
+            _levels[tick] = nullptr;
+            _occupied.clear(tick);
+        }
+
+        // function for the occupied level with the next higher price than price, nullptr if there is none
+        auto above(Price price) const noexcept -> MEOrderAtPrice* {
+            const auto next = _occupied.above(toTick(price));
+            return (next == HierarchicalBitmap::NONE ? nullptr : _levels[next]);
+        }
+
+        // function for the occupied level with the next lower price than price, nullptr if there is none
+        auto below(Price price) const noexcept -> MEOrderAtPrice* {
+            const auto next = _occupied.below(toTick(price));
+            return (next == HierarchicalBitmap::NONE ? nullptr : _levels[next]);
+        }
+
+        auto recenters() const noexcept -> size_t {
+            return _recenters;
+        }
+
+    private:
+        auto toTick(Price price) const noexcept -> int64_t {
+            const auto offset = static_cast<int64_t>(price) - _base;
+            // round towards -infinity so prices below the window never land on tick 0
+            return (offset >= 0 ? offset / _tickSize : (offset - _tickSize + 1) / _tickSize);
+        }
+
+        // moves the window so it covers tick (relative to the current one) and every occupied tick with the slack
+        // split evenly on both sides
+        auto recenter(int64_t tick) noexcept -> bool {
+            const auto window = static_cast<int64_t>(_levels.size());
+            int64_t lo = tick, hi = tick;
+            if (!_occupied.empty()) {
+                lo = std::min(lo, static_cast<int64_t>(_occupied.lowest()));
+                hi = std::max(hi, static_cast<int64_t>(_occupied.highest()));
+            }
+            if (hi - lo >= window)
+                return false;
+
+            const auto shift = lo - (window - (hi - lo + 1)) / 2;
+            if (!_occupied.empty()) {
+                // levels move down when the window moves up and the other way round, go in the order that never
+                // overwrites a level not moved yet
+                const auto move = [&](size_t from) {
+                    const auto to = static_cast<size_t>(static_cast<int64_t>(from) - shift);
+                    _levels[to] = _levels[from];
+                    _levels[from] = nullptr;
+                    _occupied.clear(from);
+                    _occupied.set(to);
+                };
+                if (shift > 0) {
+                    for (auto from = _occupied.lowest(); from != HierarchicalBitmap::NONE; from = _occupied.above(from))
+                        move(from);
+                } else {
+                    for (auto from = _occupied.highest(); from != HierarchicalBitmap::NONE; from = _occupied.below(from))
+                        move(from);
+                }
+            }
+
+            _base += shift * _tickSize;
+            _recenters++;
+            return true;
+        }
+
+        const Price _tickSize;
+        // price of the first tick of the window
+        int64_t _base = 0;
+        std::vector<MEOrderAtPrice*> _levels;
+        HierarchicalBitmap _occupied;
+        size_t _recenters = 0;
+    };
+}
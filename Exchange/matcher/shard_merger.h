@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <limits>
+#include <vector>
+#include "macros.h"
+#include "lf_queue.h"
+
+using namespace Common;
+
+namespace Exchange {
+    // message sent by a matching shard & the seq of the request it was sent for
+    template<typename T>
+    struct ShardOutput {
+        size_t requestSeq = 0;
+        T msg;
+    };
+
+    // merges the messages the matching shards sent into the order of the requests they were sent for, the stream it
+    // publishes is the one a single matching thread would have sent for the same requests
+    template<typename T>
+    class ShardMerger final {
+    public:
+        explicit ShardMerger(LFQueue<T>* queue) : _outgoing(queue) {}
+
+        ShardMerger() = delete;
+        ShardMerger(const ShardMerger&) = delete;
+        ShardMerger(const ShardMerger&&) = delete;
+        ShardMerger& operator=(const ShardMerger&) = delete;
+        ShardMerger& operator=(const ShardMerger&&) = delete;
+
+        // adds a shard, its messages must be written in request order and every message it writes after publishing
+        // watermark W must belong to a request with seq W or later
+        auto addInput(LFQueue<ShardOutput<T>>* msgs, const std::atomic<size_t>* watermark) noexcept -> void {
+            _inputs.push_back({msgs, watermark});
+        }
+
+        // publishes the messages of the requests before the lowest watermark of all shards in request order, the
+        // messages of a request that went to several shards (a mass cancel over all tickers) follow shard order
+        auto mergeAndPublish() noexcept -> void {
+            auto watermark = std::numeric_limits<size_t>::max();
+            for (const auto& input : _inputs)
+                watermark = std::min(watermark, input.watermark->load(std::memory_order_acquire));
+
+            while (true) {
+                const ShardOutput<T>* next = nullptr;
+                Input* nextInput = nullptr;
+
+                for (auto& input : _inputs) {
+                    const auto head = input.msgs->getNextRead();
+                    if (head && head->requestSeq < watermark && (!next || head->requestSeq < next->requestSeq)) {
+                        next = head;
+                        nextInput = &input;
+                    }
+                }
+
+                if (!next)
+                    break;
+
+                auto nextWrite = _outgoing->getNextWriteTo();
+                *nextWrite = next->msg;
+                _outgoing->updateWriteIndex();
+                nextInput->msgs->updateReadIndex();
+            }
+        }
+
+    private:
+        struct Input {
+            LFQueue<ShardOutput<T>>* msgs = nullptr;
+            const std::atomic<size_t>* watermark = nullptr;
+        };
+
+        LFQueue<T>* _outgoing = nullptr;
+        std::vector<Input> _inputs;
+    };
+}
@@ -2,17 +2,20 @@
 
 #include <sstream>
 #include "types.h"
-#include "types.h"
 #include "lf_queue.h"
+#include "wire_codec.h"
 
 using namespace Common;
 
 namespace Exchange {
-#pragma pack(push, 1)
     enum class ClientRequestType : uint8_t {
         INVALID = 0,
         NEW = 1,
         CANCEL = 2,
+        MODIFY = 3, // amends price & qty (the new leaves qty) of a resting order
+        MASS_CANCEL = 4, // cancels every order of the client, of one ticker unless TickerId_INVALID and one side unless Side::Invalid
+        QUOTE = 5, // replaces the quote of the client on side of ticker, qty 0 pulls it, the order server sends one per side of a mass quote entry
+        MASS_QUOTE_END = 6, // follows the quotes of a mass quote (orderId), acknowledged with a MASS_QUOTE_ACK, qty holds the number of entries
     };
 
     inline std::string clientRequestTypeToString(ClientRequestType type) noexcept {
@@ -24,6 +27,14 @@ namespace Exchange {
             return "NEW";
         case ClientRequestType::CANCEL:
             return "CANCEL";
+        case ClientRequestType::MODIFY:
+            return "MODIFY";
+        case ClientRequestType::MASS_CANCEL:
+            return "MASS_CANCEL";
+        case ClientRequestType::QUOTE:
+            return "QUOTE";
+        case ClientRequestType::MASS_QUOTE_END:
+            return "MASS_QUOTE_END";
         }
 
         return "UNKNOWN";
@@ -57,7 +68,7 @@ namespace Exchange {
 
     // struct that represents message sent by market participant to order gateway
     struct OMClientRequest {
-        size_t seqNum; // for sync purposes
+        size_t seqNum = 0; // for sync purposes
         MEClientRequest meClientRequest;
 
         auto toString() const {
@@ -71,7 +82,118 @@ namespace Exchange {
         }
     };
 
-#pragma pack(pop)
+    // layout of OMClientRequest on the wire, see wire_codec.h
+    using OMClientRequestCodec = WireCodec<OMClientRequest, 1, 1,
+        WireField<uint32_t, &OMClientRequest::seqNum>,
+        WireField<uint8_t, &OMClientRequest::meClientRequest, &MEClientRequest::type>,
+        WireField<uint16_t, &OMClientRequest::meClientRequest, &MEClientRequest::clientId>,
+        WireField<uint16_t, &OMClientRequest::meClientRequest, &MEClientRequest::tickerId>,
+        WireField<uint64_t, &OMClientRequest::meClientRequest, &MEClientRequest::orderId>,
+        WireField<int8_t, &OMClientRequest::meClientRequest, &MEClientRequest::side>,
+        WireField<int32_t, &OMClientRequest::meClientRequest, &MEClientRequest::price>,
+        WireField<uint32_t, &OMClientRequest::meClientRequest, &MEClientRequest::qty>>;
+
+    // bid & ask a market maker quotes on one ticker, a side with Qty_INVALID keeps the quote it has & one with qty 0
+    // (or Price_INVALID) pulls it
+    struct MassQuoteEntry {
+        TickerId tickerId = TickerId_INVALID;
+        Price bidPrice = Price_INVALID;
+        Qty bidQty = Qty_INVALID;
+        Price askPrice = Price_INVALID;
+        Qty askQty = Qty_INVALID;
+
+        auto toString() const {
+            std::stringstream ss;
+            ss << "MassQuoteEntry"
+            << " ["
+            << "ticker:" << tickerIdToString(tickerId)
+            << " bid:" << qtyToString(bidQty) << "@" << priceToString(bidPrice)
+            << " ask:" << qtyToString(askQty) << "@" << priceToString(askPrice)
+            << "]";
+            return ss.str();
+        }
+    };
+
+    // message sent by market participant to replace its quotes on many tickers at once, the order server turns every
+    // side of an entry into a QUOTE & sequences them back to back, followed by a MASS_QUOTE_END
+    struct OMMassQuote {
+        size_t seqNum = 0; // for sync purposes, a mass quote takes a single one
+        ClientId clientId = ClientId_INVALID;
+        OrderId quoteId = OrderId_INVALID; // client order id of the quotes it places, their fills & the ack report it
+        size_t numEntries = 0;
+        std::array<MassQuoteEntry, ME_MAX_MASS_QUOTE_ENTRIES> entries;
+
+        auto toString() const {
+            std::stringstream ss;
+            ss << "OMMassQuote"
+            << " ["
+            << "seq:" << seqNum
+            << " client:" << clientIdToString(clientId)
+            << " qid:" << orderIdToString(quoteId)
+            << " entries:" << numEntries;
+            for (size_t i = 0; i < numEntries && i < entries.size(); i++)
+                ss << " " << entries[i].toString();
+            ss << "]";
+            return ss.str();
+        }
+    };
+
+    // layout of OMMassQuote on the wire: its fixed block & a repeating group of entries, see wire_codec.h
+    struct OMMassQuoteCodec {
+        using Block = WireCodec<OMMassQuote, 5, 1,
+            WireField<uint32_t, &OMMassQuote::seqNum>,
+            WireField<uint16_t, &OMMassQuote::clientId>,
+            WireField<uint64_t, &OMMassQuote::quoteId>>;
+        using Entry = WireCodec<MassQuoteEntry, 5, 1,
+            WireField<uint16_t, &MassQuoteEntry::tickerId>,
+            WireField<int32_t, &MassQuoteEntry::bidPrice>,
+            WireField<uint32_t, &MassQuoteEntry::bidQty>,
+            WireField<int32_t, &MassQuoteEntry::askPrice>,
+            WireField<uint32_t, &MassQuoteEntry::askQty>>;
+
+        static constexpr uint16_t templateId = Block::templateId;
+        // entries of later schema versions may grow, anything past this is not one a client could have encoded
+        static constexpr size_t MaxEntryBlockLength = 4 * Entry::BlockLength;
+        static constexpr size_t MaxMessageLength = Block::MessageLength + WIRE_GROUP_HEADER_SIZE + ME_MAX_MASS_QUOTE_ENTRIES * Entry::BlockLength;
+
+        // method for writing the message, up to MaxMessageLength bytes, returns its length
+        static auto encode(const OMMassQuote& msg, char* out) noexcept -> size_t {
+            auto length = Block::encode(msg, out);
+            encodeWireGroupHeader({static_cast<uint16_t>(Entry::BlockLength), static_cast<uint16_t>(msg.numEntries)}, out + length);
+            length += WIRE_GROUP_HEADER_SIZE;
+            for (size_t i = 0; i < msg.numEntries; i++, length += Entry::BlockLength)
+                Entry::encodeBlock(msg.entries[i], out + length);
+            return length;
+        }
+
+        // function for checking the group header as soon as it is among the len bytes at in, which hold at least the
+        // fixed block, a group of more entries than fit (or of oversized ones) is rejected before waiting for its entries
+        static auto validGroup(const char* in, size_t len) noexcept -> bool {
+            const auto offset = WIRE_HEADER_SIZE + decodeWireHeader(in).blockLength;
+            if (offset + WIRE_GROUP_HEADER_SIZE > len)
+                return true;
+            const auto group = decodeWireGroupHeader(in + offset);
+            return (group.numInGroup <= ME_MAX_MASS_QUOTE_ENTRIES && group.blockLength <= MaxEntryBlockLength);
+        }
+
+        // method for reading a complete message (see wireGroupMessageLength()), returns false if it is not one of ours
+        // or carries more entries than fit
+        static auto decode(const char* in, OMMassQuote& msg) noexcept -> bool {
+            if (UNLIKELY(!Block::decode(in, msg)))
+                return false;
+            auto offset = WIRE_HEADER_SIZE + decodeWireHeader(in).blockLength;
+            const auto group = decodeWireGroupHeader(in + offset);
+            if (UNLIKELY(group.numInGroup > msg.entries.size()))
+                return false;
+            offset += WIRE_GROUP_HEADER_SIZE;
+            msg.numEntries = group.numInGroup;
+            for (size_t i = 0; i < msg.numEntries; i++, offset += group.blockLength) {
+                msg.entries[i] = {};
+                Entry::decodeBlock(in + offset, group.blockLength, msg.entries[i]);
+            }
+            return true;
+        }
+    };
 
     // queue that will be used for communication between order gateway ---> matching engine  
     typedef LFQueue<MEClientRequest> ClientRequestLFQueue;
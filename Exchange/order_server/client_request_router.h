@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include "macros.h"
+#include "client_request.h"
+
+namespace Exchange {
+    // client request & its position in the single sequence the order server produced, the matching shards tag what
+    // they send with it so their outputs can be merged back into that order
+    struct SequencedClientRequest {
+        size_t seq = 0;
+        MEClientRequest request;
+    };
+
+    // queue that hands a matching shard the requests for the tickers it owns
+    typedef LFQueue<SequencedClientRequest> SequencedClientRequestLFQueue;
+
+    // splits the sequenced requests between the matching shards by ticker, every ticker belongs to one shard so its
+    // requests keep their order, written by a single thread (the sequencer of the only ingress thread or the merger)
+    class ClientRequestRouter final {
+    public:
+        explicit ClientRequestRouter(size_t numShards) {
+            ASSERT(numShards > 0, "ClientRequestRouter needs at least one shard.");
+            for (size_t i = 0; i < numShards; i++)
+                _shardRequests.push_back(new SequencedClientRequestLFQueue(ME_MAX_CLIENT_UPDATES));
+        }
+
+        ~ClientRequestRouter() {
+            for (auto& requests : _shardRequests) {
+                delete requests;
+                requests = nullptr;
+            }
+        }
+
+        ClientRequestRouter() = delete;
+        ClientRequestRouter(const ClientRequestRouter&) = delete;
+        ClientRequestRouter(const ClientRequestRouter&&) = delete;
+        ClientRequestRouter& operator=(const ClientRequestRouter&) = delete;
+        ClientRequestRouter& operator=(const ClientRequestRouter&&) = delete;
+
+        // method for sequencing request & writing it to the queue of the shard owning its ticker, a mass cancel over
+        // all tickers goes to every shard under the same seq
+        auto route(const MEClientRequest& request) noexcept -> void {
+            const auto seq = _routed.load(std::memory_order_relaxed);
+            if (UNLIKELY(request.type == ClientRequestType::MASS_CANCEL && request.tickerId == TickerId_INVALID)) {
+                for (auto requests : _shardRequests)
+                    write(requests, seq, request);
+            } else {
+                write(_shardRequests[shardOf(request.tickerId)], seq, request);
+            }
+            _routed.store(seq + 1, std::memory_order_release);
+        }
+
+        // function for the shard owning tickerId, unlisted tickers land on a shard too so they are rejected in order,
+        // as does the MASS_QUOTE_END of a mass quote, the shard acking it has seen every request sequenced before
+        auto shardOf(TickerId tickerId) const noexcept -> size_t {
+            return tickerId % _shardRequests.size();
+        }
+
+        auto numShards() const noexcept -> size_t {
+            return _shardRequests.size();
+        }
+
+        auto shardRequests(size_t shard) noexcept -> SequencedClientRequestLFQueue* {
+            return _shardRequests[shard];
+        }
+
+        // every request sequenced before this one is in the queue of its shard
+        auto routed() const noexcept -> size_t {
+            return _routed.load(std::memory_order_acquire);
+        }
+
+    private:
+        static auto write(SequencedClientRequestLFQueue* requests, size_t seq, const MEClientRequest& request) noexcept -> void {
+            auto nextWrite = requests->getNextWriteTo();
+            nextWrite->seq = seq;
+            nextWrite->request = request;
+            requests->updateWriteIndex();
+        }
+
+        std::vector<SequencedClientRequestLFQueue*> _shardRequests;
+        std::atomic<size_t> _routed = {0};
+    };
+}
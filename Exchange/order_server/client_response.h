@@ -2,19 +2,22 @@
 
 #include <sstream>
 #include "types.h"
-#include "types.h"
 #include "lf_queue.h"
+#include "wire_codec.h"
 
 using namespace Common;
 
 namespace Exchange {
-#pragma pack(push, 1)
     enum class ClientResponseType : uint8_t {
         INVALID = 0,
         ACCEPTED = 1,
         CANCELED = 2,
         FILLED = 3,
         CANCEL_REJECTED = 4,
+        MODIFIED = 5,
+        MODIFY_REJECTED = 6,
+        MASS_CANCELED = 7, // sent once per mass cancel after the CANCELED of each order, leavesQty holds the number of orders canceled for a single ticker and is Qty_INVALID over all tickers
+        MASS_QUOTE_ACK = 8, // sent once all quotes of a mass quote (clientOrderId) are in, leavesQty holds the number of entries
     };
 
     inline std::string clientResponseTypeToString(ClientResponseType type) {
@@ -27,6 +30,14 @@ namespace Exchange {
             return "FILLED";
             case ClientResponseType::CANCEL_REJECTED:
             return "CANCEL_REJECTED";
+            case ClientResponseType::MODIFIED:
+            return "MODIFIED";
+            case ClientResponseType::MODIFY_REJECTED:
+            return "MODIFY_REJECTED";
+            case ClientResponseType::MASS_CANCELED:
+            return "MASS_CANCELED";
+            case ClientResponseType::MASS_QUOTE_ACK:
+            return "MASS_QUOTE_ACK";
             case ClientResponseType::INVALID:
             return "INVALID";
         }
@@ -80,7 +91,18 @@ namespace Exchange {
         };
     };
 
-#pragma pack(pop)
+    // layout of OMClientResponse on the wire, see wire_codec.h
+    using OMClientResponseCodec = WireCodec<OMClientResponse, 2, 1,
+        WireField<uint32_t, &OMClientResponse::seqNum>,
+        WireField<uint8_t, &OMClientResponse::meClientResponse, &MEClientResponse::type>,
+        WireField<uint16_t, &OMClientResponse::meClientResponse, &MEClientResponse::clientId>,
+        WireField<uint16_t, &OMClientResponse::meClientResponse, &MEClientResponse::tickerId>,
+        WireField<uint64_t, &OMClientResponse::meClientResponse, &MEClientResponse::clientOrderId>,
+        WireField<uint64_t, &OMClientResponse::meClientResponse, &MEClientResponse::marketOrderId>,
+        WireField<int8_t, &OMClientResponse::meClientResponse, &MEClientResponse::side>,
+        WireField<int32_t, &OMClientResponse::meClientResponse, &MEClientResponse::price>,
+        WireField<uint32_t, &OMClientResponse::meClientResponse, &MEClientResponse::execQty>,
+        WireField<uint32_t, &OMClientResponse::meClientResponse, &MEClientResponse::leavesQty>>;
     
     // queue that will be used for communication between order matching engine ---> order gateway  
     typedef LFQueue<MEClientResponse> ClientResponseLFQueue;
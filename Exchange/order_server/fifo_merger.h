@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include "macros.h"
+#include "logging.h"
+#include "fifo_sequencer.h"
+
+namespace Exchange {
+    // merges the requests sequenced by several ingress threads into a single stream ordered by receive time
+    class FifoMerger {
+    public:
+        FifoMerger(ClientRequestRouter* router, Logger* logger) : _incomingRequests(router), _logger(logger) {}
+
+        FifoMerger() = delete;
+        FifoMerger(const FifoMerger&) = delete;
+        FifoMerger(const FifoMerger&&) = delete;
+        FifoMerger& operator=(const FifoMerger&) = delete;
+        FifoMerger& operator=(const FifoMerger&&) = delete;
+
+        // adds an ingress thread, its requests must be written in receive time order and every request it writes
+        // after publishing watermark W must have been received at or after W
+        auto addInput(RecvTimeClientRequestLFQueue* requests, const std::atomic<Nanos>* watermark) noexcept -> void {
+            _inputs.push_back({requests, watermark});
+        }
+
+        // publishes the requests received before the lowest watermark of all inputs in receive time order
+        auto mergeAndPublish() noexcept -> void {
+            auto watermark = std::numeric_limits<Nanos>::max();
+            for (const auto& input : _inputs)
+                watermark = std::min(watermark, input.watermark->load(std::memory_order_acquire));
+
+            while (true) {
+                const RecvTimeClientRequest* next = nullptr;
+                Input* nextInput = nullptr;
+
+                // pick the earliest head among the inputs, each input is already sorted
+                for (auto& input : _inputs) {
+                    const auto head = input.requests->getNextRead();
+                    if (head && head->recvTime < watermark && (!next || head->recvTime < next->recvTime)) {
+                        next = head;
+                        nextInput = &input;
+                    }
+                }
+
+                if (!next)
+                    break;
+
+                _logger->log("%:% %() % Writing RX:% Req:% to FIFO.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), next->recvTime, next->request.toString());
+
+                _incomingRequests->route(next->request);
+                nextInput->requests->updateReadIndex();
+            }
+        }
+
+    private:
+        struct Input {
+            RecvTimeClientRequestLFQueue* requests = nullptr;
+            const std::atomic<Nanos>* watermark = nullptr;
+        };
+
+        ClientRequestRouter* _incomingRequests = nullptr;
+        std::vector<Input> _inputs;
+        std::string _timeStr;
+        Logger* _logger = nullptr;
+    };
+}
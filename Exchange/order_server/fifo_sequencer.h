@@ -1,63 +1,184 @@
 #pragma once
 
+#include <vector>
+#include <algorithm>
+#include <sstream>
 #include "thread_utils.h"
 #include "macros.h"
-#include "client_request.h"
+#include "client_request_router.h"
 
 namespace Exchange {
-    constexpr size_t ME_MAX_PENDING_REQUESTS = 1024; // max number of pending cllient requests
+    constexpr size_t ME_MAX_PENDING_REQUESTS = 1024; // number of pending client requests we reserve space for
+
+    // struct representing client request & time it was sent
+    struct RecvTimeClientRequest{
+        Nanos recvTime = 0;
+        MEClientRequest request;
+
+        // for checking which request was sent first
+        auto operator<(const RecvTimeClientRequest &rhs) const noexcept {
+            return (recvTime < rhs.recvTime);
+        }
+    };
+
+    // struct representing how long FifoSequencer holds requests before sequencing them, trading latency for fairness
+    // a zero window sequences whatever was read at the end of every read pass
+    struct FifoSequencerCfg {
+        Nanos windowNanos = 0; // max time the first pending request is held for
+        size_t maxBatchRequests = 0; // sequence as soon as this many requests are pending, 0 for no limit
+
+        auto toString() const noexcept -> std::string {
+            std::stringstream ss;
+            ss << "FifoSequencerCfg{"
+            << "window:" << windowNanos << "ns "
+            << "max-batch:" << maxBatchRequests
+            << "}";
+            return ss.str();
+        }
+    };
+
+    // queue used by sequencers of different ingress threads to hand their requests to the FifoMerger
+    typedef LFQueue<RecvTimeClientRequest> RecvTimeClientRequestLFQueue;
 
     class FifoSequencer {
     public:
-        FifoSequencer(ClientRequestLFQueue* queue, Logger* logger) : _incomingRequests(queue), _logger(logger) {}
+        FifoSequencer(ClientRequestRouter* router, Logger* logger, const FifoSequencerCfg& cfg = {}) : _incomingRequests(router), _logger(logger), _cfg(cfg) {
+            reserve();
+        }
+        // used when several sequencers run in parallel, requests keep their rx time so they can be merged later on
+        FifoSequencer(RecvTimeClientRequestLFQueue* queue, Logger* logger, const FifoSequencerCfg& cfg = {}) : _timedRequests(queue), _logger(logger), _cfg(cfg) {
+            reserve();
+        }
+
+        // add requests to pending requests, a request received before the previous one starts a new run
+        auto addClientRequest(Nanos rxTime, const MEClientRequest& request) noexcept -> void {
+            if (UNLIKELY(_pendingRequests.empty())) {
+                _windowStart = Common::getCurrentNanos();
+                _minPendingRecvTime = rxTime;
+            }
+
+            if (UNLIKELY(_pendingRequests.empty() || rxTime < _pendingRequests.back().recvTime))
+                _runStarts.push_back(_pendingRequests.size());
 
-        // add requests to pending requests array
-        auto addClientRequest(Nanos rxTime, const MEClientRequest& request) noexcept {
-            if (_pendingSize >= ME_MAX_PENDING_REQUESTS)
-                FATAL("Too many pending requests");
-            
-            _pendingRequests.at(_pendingSize++) = std::move(RecvTimeClientRequest{rxTime, request});
+            _pendingRequests.push_back(RecvTimeClientRequest{rxTime, request});
+            _minPendingRecvTime = std::min(_minPendingRecvTime, rxTime);
         }
 
-        // sorts requests by time and sends them for processing to matching engine via queue
-        auto sequenceAndPublish() noexcept {
-            if (UNLIKELY(!_pendingSize))
+        // sequences pending requests if the window has elapsed or the batch is full, meant to be called on every loop
+        auto publishIfDue(Nanos now) noexcept -> void {
+            if (_pendingRequests.empty())
                 return;
 
-            _logger->log("%:% %() % Processing % requests.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), _pendingSize);
+            if (!_cfg.windowNanos || now - _windowStart >= _cfg.windowNanos ||
+                (_cfg.maxBatchRequests && _pendingRequests.size() >= _cfg.maxBatchRequests))
+                sequenceAndPublish();
+        }
+
+        // earliest receive time among requests not yet published, or max if none are pending
+        auto minPendingRecvTime() const noexcept -> Nanos {
+            return (_pendingRequests.empty() ? std::numeric_limits<Nanos>::max() : _minPendingRecvTime);
+        }
 
-            std::sort(_pendingRequests.begin(), _pendingRequests.begin() + _pendingSize);
+        // merges the runs of pending requests by time and sends them for processing to matching engine via queue
+        auto sequenceAndPublish() noexcept -> void {
+            if (UNLIKELY(_pendingRequests.empty()))
+                return;
 
-            for (size_t i = 0; i < _pendingSize; i++) {
-                const auto request = _pendingRequests.at(i);
+            const auto holdTime = Common::getCurrentNanos() - _windowStart;
+            _totalHoldNanos += holdTime;
+            _maxHoldNanos = std::max(_maxHoldNanos, holdTime);
+            _numBatches++;
+            _numPublishedBatch = 0;
 
-                _logger->log("%:% %() % Writing RX:% Req:% to FIFO.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), request.recvTime, request.request.toString());
+            if (LIKELY(_runStarts.size() == 1)) {
+                // already in time order
+                for (size_t i = 0; i < _pendingRequests.size(); i++)
+                    publish(i);
+            } else {
+                // k-way merge of the runs, ties are broken by the order the runs were received in
+                _runStarts.push_back(_pendingRequests.size());
+                for (size_t run = 0; run + 1 < _runStarts.size(); run++)
+                    _heap.push_back({_pendingRequests[_runStarts[run]].recvTime, run, _runStarts[run]});
+                std::make_heap(_heap.begin(), _heap.end());
 
-                auto nextWrite = _incomingRequests->getNextWriteTo();
-                *nextWrite = std::move(request.request);
-                _incomingRequests->updateWriteIndex();
+                while (!_heap.empty()) {
+                    std::pop_heap(_heap.begin(), _heap.end());
+                    auto& head = _heap.back();
+                    publish(head.index);
+
+                    if (++head.index < _runStarts[head.run + 1]) {
+                        head.recvTime = _pendingRequests[head.index].recvTime;
+                        std::push_heap(_heap.begin(), _heap.end());
+                    } else {
+                        _heap.pop_back();
+                    }
+                }
             }
-            
-            _pendingSize = 0;
+
+            _logger->log("%:% %() % Sequenced % requests in % runs held:%ns total reordered:% of % avg-held:%ns max-held:%ns\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr),
+                _pendingRequests.size(), _runStarts.size() - (_runStarts.size() > 1 ? 1 : 0), holdTime, _numReordered, _numPublished, _totalHoldNanos / _numBatches, _maxHoldNanos);
+
+            _pendingRequests.clear();
+            _runStarts.clear();
+        }
+
+        // fraction of published requests that ended up in a different position than the one they were read in
+        auto reorderRate() const noexcept -> double {
+            return (_numPublished ? static_cast<double>(_numReordered) / _numPublished : 0);
         }
 
     private:
-        ClientRequestLFQueue *_incomingRequests = nullptr;
-        std::string _timeStr;
-        Logger* _logger = nullptr;
+        auto reserve() noexcept -> void {
+            _pendingRequests.reserve(ME_MAX_PENDING_REQUESTS);
+            _runStarts.reserve(ME_MAX_PENDING_REQUESTS);
+            _heap.reserve(ME_MAX_PENDING_REQUESTS);
+        }
+
+        auto publish(size_t index) noexcept -> void {
+            const auto& request = _pendingRequests[index];
+            _numReordered += (index != _numPublishedBatch++);
+            _numPublished++;
 
-        // struct representing client request & time it was sent
-        struct RecvTimeClientRequest{
+            _logger->log("%:% %() % Writing RX:% Req:% to FIFO.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), request.recvTime, request.request.toString());
+
+            if (LIKELY(_incomingRequests)) {
+                _incomingRequests->route(request.request);
+            } else {
+                auto nextWrite = _timedRequests->getNextWriteTo();
+                *nextWrite = request;
+                _timedRequests->updateWriteIndex();
+            }
+        }
+
+        // position of the next request to be merged from a run
+        struct RunHead {
             Nanos recvTime = 0;
-            MEClientRequest request;
+            size_t run = 0;
+            size_t index = 0;
 
-            // for checking which request was sent first
-            auto operator<(RecvTimeClientRequest &rhs) const noexcept {
-                return (recvTime < rhs.recvTime);
+            // inverted so that std heap functions give us the earliest head
+            auto operator<(const RunHead &rhs) const noexcept {
+                return (recvTime > rhs.recvTime || (recvTime == rhs.recvTime && run > rhs.run));
             }
         };
 
-        std::array<RecvTimeClientRequest, ME_MAX_PENDING_REQUESTS> _pendingRequests;
-        size_t _pendingSize = 0;
+        ClientRequestRouter *_incomingRequests = nullptr;
+        RecvTimeClientRequestLFQueue *_timedRequests = nullptr;
+        std::string _timeStr;
+        Logger* _logger = nullptr;
+        const FifoSequencerCfg _cfg;
+        // time the first currently pending request was added
+        Nanos _windowStart = 0;
+        Nanos _minPendingRecvTime = 0;
+
+        // fairness window statistics
+        size_t _numPublished = 0, _numPublishedBatch = 0, _numReordered = 0, _numBatches = 0;
+        Nanos _totalHoldNanos = 0, _maxHoldNanos = 0;
+
+        // grows past ME_MAX_PENDING_REQUESTS when needed and keeps its capacity between batches
+        std::vector<RecvTimeClientRequest> _pendingRequests;
+        // index of the first request of every run of time ordered requests
+        std::vector<size_t> _runStarts;
+        std::vector<RunHead> _heap;
     };
-}
\ No newline at end of file
+}
@@ -2,16 +2,43 @@
 
 
 namespace Exchange {
-    OrderServer::OrderServer(ClientRequestLFQueue* clientRequests, ClientResponseLFQueue* clientResponses, const std::string& iface, int port) 
-    : _iface(iface), _port(port), _outgoingResponses(clientResponses), _logger("exchange_order_server.log"), _server(_logger), _fifoSequencer(clientRequests, &_logger) {
+    OrderServer::IngressShard::IngressShard(size_t index, ClientRequestRouter* clientRequests, const FifoSequencerCfg& sequencerCfg, Common::TCPBackend backend)
+    : index(index), logger("exchange_order_server_ingress" + std::to_string(index) + ".log"), server(logger, backend),
+    timedRequests(clientRequests ? 1 : ME_MAX_CLIENT_UPDATES),
+    fifoSequencer(clientRequests ? FifoSequencer(clientRequests, &logger, sequencerCfg) : FifoSequencer(&timedRequests, &logger, sequencerCfg)),
+    acceptedFds(ME_MAX_CLIENTS) {}
+
+    OrderServer::OrderServer(ClientRequestRouter* clientRequests, ClientResponseLFQueue* clientResponses, const std::string& iface, int port, size_t numIngressThreads, const FifoSequencerCfg& sequencerCfg, Common::TCPBackend backend,
+                             bool cancelOnDisconnect)
+    : _iface(iface), _port(port), _outgoingResponses(clientResponses), _egressLogger("exchange_order_server_egress.log"),
+    _mergerLogger("exchange_order_server_merger.log"), _fifoMerger(clientRequests, &_mergerLogger) {
+        ASSERT(numIngressThreads > 0, "OrderServer needs at least one ingress thread.");
         _cidNextExpSeqNum.fill(1);
         _cidNextOutgoingSeqNum.fill(1);
-        _cidTcpSocket.fill(nullptr);
-        _server.recv_callback = [this](auto socket, auto rx_time) {
-            recvCallback(socket, rx_time);
-        };
-        _server.recv_finished_callback = [this]() {
-            recvFinishedCallback();
+        for (auto& socket : _cidTcpSocket)
+            socket = nullptr;
+
+        if (backend != Common::TCPBackend::EPOLL)
+            _egressRing = new Common::TCPRing(_egressLogger, backend == Common::TCPBackend::IO_URING_SQPOLL);
+
+        // with a single ingress thread its sequencer publishes straight to the matching engine
+        for (size_t i = 0; i < numIngressThreads; i++) {
+            auto shard = new IngressShard(i, numIngressThreads == 1 ? clientRequests : nullptr, sequencerCfg, backend);
+            // the egress thread and _cidTcpSocket keep pointers to sessions after they disconnect
+            shard->server.recycle_sockets = false;
+            if (numIngressThreads > 1)
+                _fifoMerger.addInput(&shard->timedRequests, &shard->watermark);
+            // whatever a client has resting is canceled when its connection closes
+            if (cancelOnDisconnect) {
+                shard->server.disconnect_callback = [this, shard](auto socket) {
+                    disconnectCallback(shard, socket);
+                };
+            }
+            _ingressShards.push_back(shard);
+        }
+
+        _ingressShards[0]->server.accept_callback = [this](auto fd) {
+            acceptCallback(fd);
         };
     }
 
@@ -19,33 +46,112 @@ namespace Exchange {
         stop();
         using namespace std::literals::chrono_literals;
         std::this_thread::sleep_for(1s);
+        for (auto& shard : _ingressShards) {
+            delete shard;
+            shard = nullptr;
+        }
+        delete _egressRing;
+        _egressRing = nullptr;
     }
 
     auto OrderServer::start() noexcept -> void {
         _run = true;
-        _server.listen(_iface, _port);
-        ASSERT(Common::createAndStartThread(-1, "Exchange/OrderServer", [this](){run();}) != nullptr, "Failed to start OrderServer thread.");
+        _ingressShards[0]->server.listen(_iface, _port);
+        for (size_t i = 1; i < _ingressShards.size(); i++)
+            _ingressShards[i]->server.init();
+
+        for (auto shard : _ingressShards)
+            ASSERT(Common::createAndStartThread(-1, "Exchange/OrderServer/Ingress" + std::to_string(shard->index), [this, shard](){runIngress(shard);}) != nullptr, "Failed to start OrderServer ingress thread.");
+        if (_ingressShards.size() > 1)
+            ASSERT(Common::createAndStartThread(-1, "Exchange/OrderServer/Merger", [this](){runMerger();}) != nullptr, "Failed to start OrderServer merger thread.");
+        ASSERT(Common::createAndStartThread(-1, "Exchange/OrderServer/Egress", [this](){runEgress();}) != nullptr, "Failed to start OrderServer egress thread.");
     }
 
-    auto OrderServer::run() noexcept -> void {
-        _logger.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr));
+    auto OrderServer::runIngress(IngressShard* shard) noexcept -> void {
+        shard->logger.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&shard->timeStr));
+        IngressHandler handler{this, shard};
         while(_run) {
-            _server.poll();
-            _server.sendAndRecv();
+            // anything not read during this pass will carry a receive time after passStart
+            const auto passStart = Common::getCurrentNanos();
+
+            for (auto fd = shard->acceptedFds.getNextRead(); shard->acceptedFds.size() && fd; fd = shard->acceptedFds.getNextRead()) {
+                shard->logger.log("%:% %() % adding socket:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&shard->timeStr), *fd);
+                shard->server.addSocket(*fd);
+                shard->acceptedFds.updateReadIndex();
+            }
+
+            shard->server.poll();
+            shard->server.recv(handler);
+
+            // flush requests whose sequencing window expired without new data arriving
+            shard->fifoSequencer.publishIfDue(Common::getCurrentNanos());
+            // requests still held in the sequencing window have not been handed to the merger yet
+            shard->watermark.store(std::min(passStart, shard->fifoSequencer.minPendingRecvTime()), std::memory_order_release);
+        }
+    }
 
+    auto OrderServer::runMerger() noexcept -> void {
+        _mergerLogger.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_mergerTimeStr));
+        while(_run) {
+            _fifoMerger.mergeAndPublish();
+        }
+    }
+
+    auto OrderServer::acceptCallback(int fd) noexcept -> void {
+        auto shard = _ingressShards[_nextAcceptShard];
+        _nextAcceptShard = (_nextAcceptShard + 1) % _ingressShards.size();
+
+        // the listening shard can take the socket right away
+        if (shard == _ingressShards[0]) {
+            shard->server.addSocket(fd);
+            return;
+        }
+
+        *shard->acceptedFds.getNextWriteTo() = fd;
+        shard->acceptedFds.updateWriteIndex();
+    }
+
+    auto OrderServer::runEgress() noexcept -> void {
+        _egressLogger.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_egressTimeStr));
+        while(_run) {
             for (auto clientResponse = _outgoingResponses->getNextRead(); _outgoingResponses->size() && clientResponse; clientResponse = _outgoingResponses->getNextRead()) {
                 auto& nextOutgoingSeqNum = _cidNextOutgoingSeqNum[clientResponse->clientId];
-                _logger.log("%:% %() % Processing cid:% seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), clientResponse->clientId, nextOutgoingSeqNum, clientResponse->toString());
+                _egressLogger.log("%:% %() % Processing cid:% seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_egressTimeStr), clientResponse->clientId, nextOutgoingSeqNum, clientResponse->toString());
 
                 // make sure that the client socket exists
-                    ASSERT(_cidTcpSocket[clientResponse->clientId] != nullptr, "Dont have a TCPSocket for ClientId:" + std::to_string(clientResponse->clientId));
+                auto socket = _cidTcpSocket[clientResponse->clientId].load(std::memory_order_acquire);
+                ASSERT(socket != nullptr, "Dont have a TCPSocket for ClientId:" + std::to_string(clientResponse->clientId));
 
-                _cidTcpSocket[clientResponse->clientId]->send(&nextOutgoingSeqNum, sizeof(nextOutgoingSeqNum));
-                _cidTcpSocket[clientResponse->clientId]->send(clientResponse, sizeof(clientResponse));
+                // nothing queued on this socket yet, remember to flush it
+                if (!socket->sendSize()) {
+                    socket->send_logger = &_egressLogger;
+                    socket->send_ring = _egressRing;
+                    // the send half belongs to this thread, keep the ingress thread's server out of it
+                    socket->send_list = nullptr;
+                    _pendingFlushSockets[_numPendingFlushSockets++] = socket;
+                }
+
+                char encoded[OMClientResponseCodec::MessageLength];
+                socket->send(encoded, OMClientResponseCodec::encode({nextOutgoingSeqNum, *clientResponse}, encoded));
 
                 _outgoingResponses->updateReadIndex();
                 nextOutgoingSeqNum++;
             }
+
+            // one send per session for everything queued this loop, sockets with bytes left over (or still in flight
+            // on the egress ring) are retried next loop
+            size_t numStillPending = 0;
+            for (size_t i = 0; i < _numPendingFlushSockets; i++) {
+                auto socket = _pendingFlushSockets[i];
+                socket->flush();
+                if (socket->sendSize() && !socket->send_disconnected)
+                    _pendingFlushSockets[numStillPending++] = socket;
+            }
+            _numPendingFlushSockets = numStillPending;
+
+            // submits the sends queued above and releases the bytes of completed ones
+            if (_egressRing)
+                _egressRing->poll();
         }
     }
 
@@ -53,46 +159,126 @@ namespace Exchange {
         _run = false;
     }
 
-    auto OrderServer::recvCallback(TCPSocket *socket, Nanos rxTime) noexcept -> void {
-        _logger.log("%:% %() % Received socket:% len:% rx:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), socket->fd, socket->next_recv_valid_index, rxTime);
-        
-        if (socket->next_recv_valid_index >= sizeof(OMClientRequest)) {
-            size_t i = 0;
-            // loop through all the requests that client has sent
-            for (; i + sizeof(OMClientRequest) <= socket->next_recv_valid_index; i += sizeof(OMClientRequest)) {
-                auto request = reinterpret_cast<const OMClientRequest*>(socket->recv_buffer.data() + i);
-                _logger.log("%:% %() % Received %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), request->toString());
-            
-                auto clientSocket = _cidTcpSocket[request->meClientRequest.clientId];
-                // check if this is client's first request
-                if (UNLIKELY(clientSocket == nullptr)) {
-                    _cidTcpSocket[request->meClientRequest.clientId] = socket;
-                }
+    auto OrderServer::recvCallback(IngressShard* shard, TCPSocket *socket, Nanos rxTime) noexcept -> void {
+        shard->logger.log("%:% %() % Received socket:% len:% rx:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&shard->timeStr), socket->fd, socket->recvSize(), rxTime);
+
+        // a session being torn down can not be framed anymore
+        if (UNLIKELY(socket->recv_disconnected)) {
+            socket->commitRecv(socket->recvSize());
+            return;
+        }
 
-                // check that client has sent request from same socket
-                if(clientSocket!= socket) {
-                    _logger.log("%:% %() % Received ClientRequest from ClientId:% on different socket:% expected:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), request->meClientRequest.clientId, socket->fd, _cidTcpSocket[request->meClientRequest.clientId]->fd);
+        if (socket->recvSize() >= WIRE_HEADER_SIZE) {
+            const auto data = socket->recvData();
+            const auto size = socket->recvSize();
+            size_t i = 0;
+            // loop through all the complete messages that client has sent
+            for (size_t length; (length = wireMessageLength(data + i, size - i)); i += length) {
+                if (UNLIKELY(decodeWireHeader(data + i).templateId == OMMassQuoteCodec::templateId)) {
+                    // its entries follow the fixed block, wait for all of them unless the group header says they never fit,
+                    // nothing after them could be framed either
+                    if (UNLIKELY(!OMMassQuoteCodec::validGroup(data + i, size - i))) {
+                        shard->logger.log("%:% %() % Invalid mass quote group header len:% socket:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&shard->timeStr), size - i, socket->fd);
+                        disconnectSession(shard, socket);
+                        return;
+                    }
+                    if (!(length = wireGroupMessageLength(data + i, size - i)))
+                        break;
+                    recvMassQuote(shard, socket, rxTime, data + i, length);
                     continue;
                 }
 
-                // check that sequence number sent equals expected sequence number
-                auto nextExpectedSeqNum = _cidNextExpSeqNum[request->meClientRequest.clientId];
-                if(nextExpectedSeqNum != request->seqNum) {
-                    _logger.log("%:% %() % Incorrect sequence number. ClientId:% SeqNum expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&_timeStr), request->meClientRequest.clientId, nextExpectedSeqNum, request->seqNum);
+                OMClientRequest decoded;
+                if (UNLIKELY(!OMClientRequestCodec::decode(data + i, decoded))) {
+                    shard->logger.log("%:% %() % Skipping unknown message template:% len:% socket:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&shard->timeStr), decodeWireHeader(data + i).templateId, length, socket->fd);
                     continue;
                 }
+                const auto request = &decoded;
+                shard->logger.log("%:% %() % Received %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&shard->timeStr), request->toString());
 
-                nextExpectedSeqNum++;
-                _fifoSequencer.addClientRequest(rxTime, request->meClientRequest);
+                if (UNLIKELY(!checkSession(shard, socket, request->meClientRequest.clientId, request->seqNum)))
+                    continue;
+                shard->fifoSequencer.addClientRequest(rxTime, request->meClientRequest);
             }
 
-            memcpy(socket->recv_buffer.data(), socket->recv_buffer.data() + i, socket->next_recv_valid_index - i);
-            socket->next_recv_valid_index -= i;
+            // partial request at the end stays in the ring for the next read
+            socket->commitRecv(i);
+        }
+    }
+
+    auto OrderServer::recvMassQuote(IngressShard* shard, TCPSocket* socket, Nanos rxTime, const char* data, size_t length) noexcept -> void {
+        OMMassQuote massQuote;
+        if (UNLIKELY(!OMMassQuoteCodec::decode(data, massQuote))) {
+            shard->logger.log("%:% %() % Skipping mass quote with more than % entries len:% socket:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&shard->timeStr), ME_MAX_MASS_QUOTE_ENTRIES, length, socket->fd);
+            return;
+        }
+        shard->logger.log("%:% %() % Received %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&shard->timeStr), massQuote.toString());
+
+        if (UNLIKELY(!checkSession(shard, socket, massQuote.clientId, massQuote.seqNum)))
+            return;
+
+        // the quotes & their end share a receive time, the sequencer keeps them back to back
+        for (size_t i = 0; i < massQuote.numEntries; i++) {
+            const auto& entry = massQuote.entries[i];
+            if (entry.bidQty != Qty_INVALID)
+                shard->fifoSequencer.addClientRequest(rxTime, {ClientRequestType::QUOTE, massQuote.clientId, entry.tickerId, massQuote.quoteId, Side::Buy, entry.bidPrice, entry.bidQty});
+            if (entry.askQty != Qty_INVALID)
+                shard->fifoSequencer.addClientRequest(rxTime, {ClientRequestType::QUOTE, massQuote.clientId, entry.tickerId, massQuote.quoteId, Side::Sell, entry.askPrice, entry.askQty});
+        }
+        shard->fifoSequencer.addClientRequest(rxTime, {ClientRequestType::MASS_QUOTE_END, massQuote.clientId, TickerId_INVALID, massQuote.quoteId, Side::Invalid, Price_INVALID,
+                                                       static_cast<Qty>(massQuote.numEntries)});
+    }
+
+    auto OrderServer::disconnectSession(IngressShard* shard, TCPSocket* socket) noexcept -> void {
+        shard->logger.log("%:% %() % Disconnecting socket:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&shard->timeStr), socket->fd, socket->bufferStatsToString());
+        socket->recv_disconnected = true;
+        socket->commitRecv(socket->recvSize());
+        ::shutdown(socket->fd, SHUT_RDWR);
+    }
+
+    auto OrderServer::checkSession(IngressShard* shard, TCPSocket* socket, ClientId clientId, size_t seqNum) noexcept -> bool {
+        if (UNLIKELY(clientId >= ME_MAX_CLIENTS)) {
+            shard->logger.log("%:% %() % Received ClientRequest from invalid ClientId:% socket:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&shard->timeStr), clientId, socket->fd);
+            return false;
+        }
+
+        auto clientSocket = _cidTcpSocket[clientId].load(std::memory_order_acquire);
+        // check if this is client's first request, claim the client for this socket and publish it to the egress thread
+        if (UNLIKELY(clientSocket == nullptr)) {
+            if (_cidTcpSocket[clientId].compare_exchange_strong(clientSocket, socket, std::memory_order_acq_rel))
+                clientSocket = socket;
+        }
+
+        // check that client has sent request from same socket
+        if(clientSocket != socket) {
+            shard->logger.log("%:% %() % Received ClientRequest from ClientId:% on different socket:% expected:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&shard->timeStr), clientId, socket->fd, clientSocket->fd);
+            return false;
+        }
+
+        // check that sequence number sent equals expected sequence number
+        auto& nextExpectedSeqNum = _cidNextExpSeqNum[clientId];
+        if(nextExpectedSeqNum != seqNum) {
+            shard->logger.log("%:% %() % Incorrect sequence number. ClientId:% SeqNum expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&shard->timeStr), clientId, nextExpectedSeqNum, seqNum);
+            return false;
+        }
+
+        nextExpectedSeqNum++;
+        return true;
+    }
+
+    auto OrderServer::disconnectCallback(IngressShard* shard, TCPSocket* socket) noexcept -> void {
+        // goes through the sequencer like any request, so what the client sent before it disconnected is processed first
+        for (size_t clientId = 0; clientId < ME_MAX_CLIENTS; clientId++) {
+            if (_cidTcpSocket[clientId].load(std::memory_order_acquire) != socket)
+                continue;
+
+            shard->logger.log("%:% %() % Canceling orders of ClientId:% on disconnect of socket:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&shard->timeStr), clientId, socket->fd);
+            shard->fifoSequencer.addClientRequest(Common::getCurrentNanos(), {ClientRequestType::MASS_CANCEL, static_cast<ClientId>(clientId), TickerId_INVALID, OrderId_INVALID, Side::Invalid, Price_INVALID, Qty_INVALID});
         }
     }
 
-    auto OrderServer::recvFinishedCallback() noexcept -> void {
-        _fifoSequencer.sequenceAndPublish();
+    auto OrderServer::recvFinishedCallback(IngressShard* shard) noexcept -> void {
+        shard->fifoSequencer.publishIfDue(Common::getCurrentNanos());
     }
 
 }
@@ -7,37 +7,96 @@
 #include "client_request.h"
 #include "client_response.h"
 #include "fifo_sequencer.h"
+#include "fifo_merger.h"
 
 namespace Exchange {
     // class representing order gateway server
     class OrderServer {
     public:
-        OrderServer(ClientRequestLFQueue* clientRequests, ClientResponseLFQueue* clientResponses, const std::string& iface, int port);
+        OrderServer(ClientRequestRouter* clientRequests, ClientResponseLFQueue* clientResponses, const std::string& iface, int port, size_t numIngressThreads = 1, const FifoSequencerCfg& sequencerCfg = {}, Common::TCPBackend backend = Common::TCPBackend::EPOLL,
+                    bool cancelOnDisconnect = false);
         ~OrderServer();
         
         auto stop() noexcept -> void;
         auto start() noexcept -> void;
 
     private:
-        auto run() noexcept -> void;
+        // state owned by a single ingress thread, client sessions are spread across ingress threads
+        struct IngressShard {
+            IngressShard(size_t index, ClientRequestRouter* clientRequests, const FifoSequencerCfg& sequencerCfg, Common::TCPBackend backend);
 
-        auto recvCallback(TCPSocket *socket, Nanos rxTime) noexcept -> void;
-        auto recvFinishedCallback() noexcept -> void;
+            const size_t index;
+            std::string timeStr;
+            Logger logger;
+            Common::TCPServer server;
+            // sequenced requests waiting for the merger, only used with more than one ingress thread
+            RecvTimeClientRequestLFQueue timedRequests;
+            // every request written to timedRequests from now on is received at or after this time
+            std::atomic<Nanos> watermark = {0};
+            FifoSequencer fifoSequencer;
+            // connections accepted by the listening shard and handed over to this one
+            LFQueue<int> acceptedFds;
+        };
+
+        // hands a shard's reads to OrderServer, its type lets TCPServer inline the parsing into the read loop
+        struct IngressHandler {
+            OrderServer* orderServer;
+            IngressShard* shard;
+
+            auto onRecv(TCPSocket* socket, Nanos rxTime) noexcept -> void {
+                orderServer->recvCallback(shard, socket, rxTime);
+            }
+
+            auto onRecvFinished() noexcept -> void {
+                orderServer->recvFinishedCallback(shard);
+            }
+        };
+
+        // accepts connections, reads & validates client requests and sequences them to the matching engine
+        auto runIngress(IngressShard* shard) noexcept -> void;
+        // merges the requests of all ingress threads by receive time and routes them to the matching shards
+        auto runMerger() noexcept -> void;
+        // drains matching engine responses into per-client send buffers and flushes them
+        auto runEgress() noexcept -> void;
+
+        // hands accepted connections to ingress threads in round robin fashion
+        auto acceptCallback(int fd) noexcept -> void;
+        auto recvCallback(IngressShard* shard, TCPSocket *socket, Nanos rxTime) noexcept -> void;
+        auto recvFinishedCallback(IngressShard* shard) noexcept -> void;
+        // method for sequencing the quotes of the complete mass quote of length bytes at data
+        auto recvMassQuote(IngressShard* shard, TCPSocket* socket, Nanos rxTime, const char* data, size_t length) noexcept -> void;
+        // method for ending the session of socket from the ingress thread, the bytes it still sends are dropped and
+        // the server removes it once the read side sees the shutdown
+        auto disconnectSession(IngressShard* shard, TCPSocket* socket) noexcept -> void;
+        // function for checking that clientId sends on socket (claiming it on its first request) with the next seqNum
+        auto checkSession(IngressShard* shard, TCPSocket* socket, ClientId clientId, size_t seqNum) noexcept -> bool;
+        // sequences a mass cancel for every client that sent on socket, only set up with cancel on disconnect
+        auto disconnectCallback(IngressShard* shard, TCPSocket* socket) noexcept -> void;
 
         const std::string _iface;
         const int _port;
         // queue that receives responses by matching engine to be sent to client
         ClientResponseLFQueue* _outgoingResponses = nullptr;
         volatile bool _run = false;
-        std::string _timeStr;
-        Logger _logger;
-        // tracks next seqNum to be sent to individual clients
+        // ingress, merger and egress threads can not share a logger, each one gets its own
+        std::string _egressTimeStr;
+        Logger _egressLogger;
+        std::string _mergerTimeStr;
+        Logger _mergerLogger;
+        // with an io_uring backend the egress thread submits its sends on its own ring
+        Common::TCPRing* _egressRing = nullptr;
+        // tracks next seqNum to be sent to individual clients, only touched by the egress thread
         std::array<size_t, ME_MAX_CLIENTS> _cidNextOutgoingSeqNum;
-        // tracks next seqNum to be expected by each client
+        // tracks next seqNum to be expected by each client, only touched by the ingress thread owning the client's socket
         std::array<size_t, ME_MAX_CLIENTS> _cidNextExpSeqNum;
-        // tracks tcp connections by clients
-        std::array<Common::TCPSocket*, ME_MAX_CLIENTS> _cidTcpSocket;
-        Common::TCPServer _server;
-        FifoSequencer _fifoSequencer;
+        // tracks tcp connections by clients, claimed by the ingress threads and read by the egress thread
+        std::array<std::atomic<Common::TCPSocket*>, ME_MAX_CLIENTS> _cidTcpSocket;
+        // sockets that the egress thread has bytes queued on
+        std::array<Common::TCPSocket*, ME_MAX_CLIENTS> _pendingFlushSockets;
+        size_t _numPendingFlushSockets = 0;
+        // the first shard owns the listening socket
+        std::vector<IngressShard*> _ingressShards;
+        size_t _nextAcceptShard = 0;
+        FifoMerger _fifoMerger;
     };
 }
\ No newline at end of file